@@ -0,0 +1,180 @@
+/// \file allocator.cpp
+/// Allocation, release and shrinking of payload buffers, and the
+/// fragmentation of the buffer under a random load
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+const std::size_t c_count = 1000000;
+
+typedef ipv4::payload_allocator<65536>  allocator_type;
+
+/// Allocations of random sizes and releases of random blocks. Blocks are
+/// allocated until the buffer is full up to load, then one is released
+/// for each allocation. A block is also released when an allocation fails
+struct random_load
+{
+  random_load
+  (
+    allocator_type&   a,
+    const std::size_t min_size,
+    const std::size_t max_size,
+    const std::size_t load
+  )
+  : allocator(a),
+    min_size(min_size),
+    max_size(max_size),
+    load(load)
+  {}
+
+  void
+  operator()(std::size_t)
+  {
+    if (used >= load)
+    {
+      release();
+    }
+    else
+    {
+      const std::size_t size  = min_size + r() % (max_size - min_size + 1);
+      uint8_t           *ptr  = allocator.allocate(size);
+
+      if (ptr)
+      {
+        live.emplace_back(ptr, ipv4::payload_allocation_size(size));
+        used += live.back().second;
+      }
+      else
+      {
+        release();
+      }
+    }
+  }
+
+  void
+  release()
+  {
+    if (!live.empty())
+    {
+      const std::size_t k = r() % live.size();
+
+      allocator.release(live[k].first);
+      used    -= live[k].second;
+      live[k]  = live.back();
+      live.pop_back();
+    }
+  }
+
+  allocator_type          &allocator;
+  const std::size_t       min_size;
+  const std::size_t       max_size;
+  const std::size_t       load;
+  /// blocks allocated and their sizes in the buffer
+  std::vector<std::pair<uint8_t*, std::size_t>> live;
+  std::size_t             used = 0;
+  random                  r;
+};
+
+void
+run_load
+(
+  const std::string&  name,
+  const std::size_t   min_size,
+  const std::size_t   max_size,
+  const std::size_t   load
+)
+{
+  auto        a     = std::make_unique<allocator_type>();
+  random_load l(*a, min_size, max_size, load);
+  double      used  = 0;
+  double      free  = 0;
+  double      large = 0;
+
+  for (std::size_t k = 0; k < c_count; k++)
+  {
+    l(k);
+  }
+
+  row(name, measure(c_count, l));
+
+  // The largest free block against all free space, sampled while the
+  // load goes on. Failures are counted from the start of the load
+  for (std::size_t k = 0; k < 100000; k++)
+  {
+    l(k);
+
+    if (k % 100 == 0)
+    {
+      auto st = a->statistics();
+
+      used  += double(st.used);
+      free  += double(st.capacity - st.used);
+      large += double(st.largest_free);
+    }
+  }
+
+  auto st = a->statistics();
+
+  row("  used, % of capacity", 100.0 * used / (used + free));
+  row("  largest free block, % of free", 100.0 * large / free);
+  row("  failed allocations, %", 100.0 * st.failures / (st.allocations + st.failures));
+}
+
+} // namespace
+
+void
+bench_allocator()
+{
+  std::cout << "Payload allocator, 64 KiB (ns per operation)\n";
+
+  {
+    auto a = std::make_unique<allocator_type>();
+
+    row
+    (
+      "allocate and release 1500",
+      measure
+      (
+        c_count,
+        [&](std::size_t)
+        {
+          uint8_t *ptr = a->allocate(1500);
+
+          keep(ptr);
+          a->release(ptr);
+        }
+      )
+    );
+
+    row
+    (
+      "allocate 1500, shrink, release",
+      measure
+      (
+        c_count,
+        [&](std::size_t k)
+        {
+          uint8_t *ptr = a->allocate(1500);
+
+          a->shrink(ptr, 64 + k % 1024);
+          a->release(ptr);
+        }
+      )
+    );
+  }
+
+  run_load("random 64..1518, 50% load", 64, 1518, 32768);
+  run_load("random 64..1518, 90% load", 64, 1518, 58982);
+  run_load("random 64..9018, 75% load", 64, 9018, 49152);
+}
+
+} // namespace bench
@@ -0,0 +1,166 @@
+/// \file arp_cache.cpp
+/// Lookup, insertion and replacement in the ARP cache, against a linear
+/// table like the one it replaced
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+const std::size_t       c_count   = 1000000;
+const ethernet::address c_hw_addr = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+ipv4::address
+ip_address
+(
+  const uint32_t  n
+)
+{
+  return { 10, uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n) };
+}
+
+ethernet::address
+hw_address
+(
+  const uint32_t  n
+)
+{
+  return { 0x02, 0x00, uint8_t(n >> 24), uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n) };
+}
+
+/// Table searched from its start, as the ARP table was before the cache
+template<std::size_t Size>
+struct linear_table
+{
+  ipv4::arp_table_entry*
+  find
+  (
+    const ipv4::address&  a
+  )
+  {
+    auto it = std::find_if
+    (
+      std::begin(entries),
+      std::end(entries),
+      [&a](const ipv4::arp_table_entry& e)
+      {
+        return e.is_occupied() && e.ip_addr == a;
+      }
+    );
+
+    return (it != std::end(entries)) ? &*it : nullptr;
+  }
+
+  ipv4::arp_table_entry entries[Size];
+};
+
+template<std::size_t Size>
+void
+run()
+{
+  typedef ipv4::arp_cache<ipv4::arp_table_entry, Size> cache_type;
+
+  // Half of the cache is filled, each window then has free slots
+  const std::size_t           filled = Size / 2;
+  std::vector<ipv4::address>  present;
+  std::vector<ipv4::address>  absent;
+  std::vector<ipv4::address>  fresh;
+  random                      r;
+
+  for (std::size_t n = 0; n < filled; n++)
+  {
+    present.push_back(ip_address(n));
+    absent.push_back(ip_address(0x8000 + n));
+  }
+
+  for (std::size_t n = 0; n < c_count; n++)
+  {
+    fresh.push_back(ip_address(0x10000 + n));
+  }
+
+  auto cache = std::make_unique<cache_type>();
+
+  for (auto &a : present)
+  {
+    cache->update(hw_address(a[3]), a, true);
+  }
+
+  std::vector<std::size_t> order(c_count);
+
+  for (auto &o : order)
+  {
+    o = r() % filled;
+  }
+
+  std::cout << Size << " entries\n";
+
+  row
+  (
+    "cache lookup, hit",
+    measure(c_count, [&](std::size_t k) { keep(cache->find(present[order[k]])); })
+  );
+
+  row
+  (
+    "cache lookup, miss",
+    measure(c_count, [&](std::size_t k) { keep(cache->find(absent[order[k]])); })
+  );
+
+  row
+  (
+    "cache update of an entry",
+    measure(c_count, [&](std::size_t k) { keep(cache->update(c_hw_addr, present[order[k]], true)); })
+  );
+
+  // Every address is new, once the cache is full each insertion replaces
+  // an entry
+  auto full = std::make_unique<cache_type>();
+
+  row
+  (
+    "cache insertion with replacement",
+    measure(c_count, [&](std::size_t k) { keep(full->update(c_hw_addr, fresh[k], true)); })
+  );
+
+  auto table = std::make_unique<linear_table<Size>>();
+
+  for (std::size_t n = 0; n < filled; n++)
+  {
+    table->entries[n] = ipv4::arp_table_entry(hw_address(n), present[n], true);
+    table->entries[n].set_occupied();
+  }
+
+  row
+  (
+    "linear lookup, hit",
+    measure(c_count, [&](std::size_t k) { keep(table->find(present[order[k]])); })
+  );
+
+  row
+  (
+    "linear lookup, miss",
+    measure(c_count, [&](std::size_t k) { keep(table->find(absent[order[k]])); })
+  );
+}
+
+} // namespace
+
+void
+bench_arp_cache()
+{
+  std::cout << "ARP cache (ns per operation)\n";
+
+  run<8>();
+  run<64>();
+  run<512>();
+  run<4096>();
+}
+
+} // namespace bench
@@ -0,0 +1,90 @@
+/// \file bench.hpp
+/// Timing of the paths of the IPV4 stack
+
+#ifndef PROTOCOL_EXAMPLES_BENCH_HPP
+#define PROTOCOL_EXAMPLES_BENCH_HPP
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#include "protocol/ipv4/stack.hpp"
+
+namespace bench
+{
+
+using namespace protocol;
+
+/// Keeps the compiler from discarding a result that is not otherwise used
+template<typename T>
+inline void
+keep
+(
+  const T&  value
+)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Runs fn count times, returns the mean time of a run in nanoseconds.
+/// fn is called in place, state it keeps carries over to later calls
+template<typename Fn>
+double
+measure
+(
+  const std::size_t count,
+  Fn&&              fn
+)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    fn(k);
+  }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  return elapsed.count() / count;
+}
+
+/// Prints one row of a table, a name followed by columns of values
+inline void
+row
+(
+  const std::string&  name,
+  const double        value
+)
+{
+  std::cout << "  " << std::left << std::setw(32) << name
+            << std::right << std::setw(10) << std::fixed << std::setprecision(1) << value << '\n';
+}
+
+/// 32 bit pseudo random sequence, the same on every run
+struct random
+{
+  uint32_t
+  operator()()
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+  }
+
+  uint32_t state = 2463534242U;
+};
+
+void bench_arp_cache();
+void bench_port_demux();
+void bench_allocator();
+void bench_checksum();
+void bench_step();
+
+} // namespace bench
+
+//  PROTOCOL_EXAMPLES_BENCH_HPP
+#endif
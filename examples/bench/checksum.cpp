@@ -0,0 +1,170 @@
+/// \file checksum.cpp
+/// Checksum kernels against the loop summing one 16 bit word at a time
+/// they replaced, and the copy kernels against a copy followed by a sum.
+/// Build with -mavx2 to include the AVX2 kernels
+
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+const std::size_t c_bytes = 400000000;
+
+typedef uint64_t (*add_kernel)(uint64_t, const void*, std::size_t);
+typedef uint64_t (*copy_kernel)(uint64_t, void*, const void*, std::size_t);
+
+/// Sum of 16 bit words, as the checksum was formed before the kernels
+uint64_t
+word_loop
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+  const uint8_t *p  = static_cast<const uint8_t*>(data);
+  uint32_t      s   = 0;
+
+  for (; size >= 2; p += 2, size -= 2)
+  {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    s += v;
+  }
+
+  if (size == 1)
+  {
+    s += *p;
+  }
+
+  return sum + s;
+}
+
+uint64_t
+copy_then_add
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+  std::memcpy(dest, src, size);
+
+  return ipv4::checksum_add_portable(sum, dest, size);
+}
+
+const std::size_t c_sizes[] = { 20, 64, 576, 1500, 9000 };
+
+const struct
+{
+  const char  *name;
+  add_kernel  add;
+}
+g_add_kernels[] =
+{
+  { "16 bit word loop", word_loop },
+  { "portable",         ipv4::checksum_add_portable },
+#if defined(__SSE2__)
+  { "sse2",             ipv4::checksum_add_sse2 },
+#endif
+#if defined(__AVX2__)
+  { "avx2",             ipv4::checksum_add_avx2 },
+#endif
+#if defined(__ARM_NEON)
+  { "neon",             ipv4::checksum_add_neon },
+#endif
+};
+
+const struct
+{
+  const char  *name;
+  copy_kernel copy;
+}
+g_copy_kernels[] =
+{
+  { "memcpy, then portable",  copy_then_add },
+  { "portable",               ipv4::checksum_copy_portable },
+#if defined(__SSE2__)
+  { "sse2",                   ipv4::checksum_copy_sse2 },
+#endif
+#if defined(__AVX2__)
+  { "avx2",                   ipv4::checksum_copy_avx2 },
+#endif
+#if defined(__ARM_NEON)
+  { "neon",                   ipv4::checksum_copy_neon },
+#endif
+};
+
+void
+header()
+{
+  std::cout << "  " << std::left << std::setw(24) << "bytes" << std::right;
+
+  for (auto size : c_sizes)
+  {
+    std::cout << std::setw(8) << size;
+  }
+
+  std::cout << '\n';
+}
+
+} // namespace
+
+void
+bench_checksum()
+{
+  // The data starts one byte past an alignment, like the payload of a
+  // frame received at an aligned address
+  std::vector<uint8_t>  source(9000 + 64);
+  std::vector<uint8_t>  dest(9000 + 64);
+  random                r;
+
+  for (auto &b : source)
+  {
+    b = uint8_t(r());
+  }
+
+  const uint8_t *data = source.data() + 1;
+
+  std::cout << "Checksum, GB/s\n";
+  header();
+
+  for (auto &k : g_add_kernels)
+  {
+    std::cout << "  " << std::left << std::setw(24) << k.name << std::right;
+
+    for (auto size : c_sizes)
+    {
+      const double ns = measure(c_bytes / size, [&](std::size_t) { keep(k.add(0U, data, size)); });
+
+      std::cout << std::setw(8) << std::fixed << std::setprecision(1) << size / ns;
+    }
+
+    std::cout << '\n';
+  }
+
+  std::cout << "Checksum and copy, GB/s\n";
+  header();
+
+  for (auto &k : g_copy_kernels)
+  {
+    std::cout << "  " << std::left << std::setw(24) << k.name << std::right;
+
+    for (auto size : c_sizes)
+    {
+      const double ns = measure(c_bytes / size, [&](std::size_t) { keep(k.copy(0U, dest.data() + 1, data, size)); });
+
+      std::cout << std::setw(8) << std::fixed << std::setprecision(1) << size / ns;
+    }
+
+    std::cout << '\n';
+  }
+}
+
+} // namespace bench
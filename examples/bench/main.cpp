@@ -0,0 +1,38 @@
+// Example compile statement
+// g++ -Wall -Wextra -O2 -I../../../haluj/include -I../../../bit/include -I../../include -std=c++17 -o bench *.cpp ../../src/protocol/ipv4/stack.cpp
+//
+// Timing of the paths of the IPV4 stack. Times are the mean of many runs
+// in nanoseconds, compare them between builds on the same machine.
+// A name given as argument runs that part only, e.g. bench allocator
+
+#include <cstring>
+
+#include "bench.hpp"
+
+struct part
+{
+  const char  *name;
+  void        (*run)();
+};
+
+const part g_parts[] =
+{
+  { "arp_cache",  bench::bench_arp_cache },
+  { "port_demux", bench::bench_port_demux },
+  { "allocator",  bench::bench_allocator },
+  { "checksum",   bench::bench_checksum },
+  { "step",       bench::bench_step },
+};
+
+int main(int argc, char *argv[])
+{
+  for (auto &p : g_parts)
+  {
+    if (argc < 2 || std::strcmp(argv[1], p.name) == 0)
+    {
+      p.run();
+    }
+  }
+
+  return 0;
+}
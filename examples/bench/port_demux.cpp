@@ -0,0 +1,139 @@
+/// \file port_demux.cpp
+/// Lookup, binding and unbinding in the port demultiplexer, against a
+/// scan of the port table like the one it replaced
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+const std::size_t c_count = 1000000;
+
+/// Port table searched from its start, as ports were before the demux
+template<std::size_t Size>
+struct linear_ports
+{
+  struct port
+  {
+    std::size_t id;
+    uint16_t    number;
+    bool        bound = false;
+  };
+
+  std::optional<std::size_t>
+  find
+  (
+    const std::size_t id,
+    const uint16_t    number
+  ) const
+  {
+    std::optional<std::size_t> result;
+
+    auto it = std::find_if
+    (
+      std::begin(ports),
+      std::end(ports),
+      [&](const port& p)
+      {
+        return p.bound && p.number == number && (p.id == id || p.id == ipv4::port_demux<Size>::c_any);
+      }
+    );
+
+    if (it != std::end(ports))
+    {
+      result = std::distance(std::begin(ports), it);
+    }
+
+    return result;
+  }
+
+  port ports[Size];
+};
+
+template<std::size_t Size>
+void
+run()
+{
+  typedef ipv4::port_demux<Size>  demux_type;
+
+  auto                  demux = std::make_unique<demux_type>();
+  auto                  table = std::make_unique<linear_ports<Size>>();
+  std::vector<uint16_t> order(c_count);
+  random                r;
+
+  // Every port is bound, spread over the port range
+  for (std::size_t n = 0; n < Size; n++)
+  {
+    const uint16_t number = uint16_t(1024 + n * 13);
+
+    demux->insert(0, number, n);
+    table->ports[n] = { 0, number, true };
+  }
+
+  for (auto &o : order)
+  {
+    o = uint16_t(1024 + (r() % Size) * 13);
+  }
+
+  std::cout << Size << " ports\n";
+
+  row
+  (
+    "demux lookup, bound",
+    measure(c_count, [&](std::size_t k) { keep(demux->find(0, order[k])); })
+  );
+
+  row
+  (
+    "demux lookup, not bound",
+    measure(c_count, [&](std::size_t k) { keep(demux->find(0, uint16_t(order[k] + 1))); })
+  );
+
+  row
+  (
+    "demux unbind and bind",
+    measure
+    (
+      c_count,
+      [&](std::size_t k)
+      {
+        demux->remove(0, order[k]);
+        keep(demux->insert(0, order[k], k % Size));
+      }
+    )
+  );
+
+  row
+  (
+    "linear lookup, bound",
+    measure(c_count, [&](std::size_t k) { keep(table->find(0, order[k])); })
+  );
+
+  row
+  (
+    "linear lookup, not bound",
+    measure(c_count, [&](std::size_t k) { keep(table->find(0, uint16_t(order[k] + 1))); })
+  );
+}
+
+} // namespace
+
+void
+bench_port_demux()
+{
+  std::cout << "Port demultiplexer (ns per operation)\n";
+
+  run<8>();
+  run<256>();
+  run<4096>();
+}
+
+} // namespace bench
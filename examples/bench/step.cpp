@@ -0,0 +1,141 @@
+/// \file step.cpp
+/// Time of a step of a stack with one interface, under UDP echo traffic
+/// and idle, with few and many buffer descriptors
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+const std::size_t c_count = 200000;
+
+/// The peer is resolved once, its entry outlives the run
+struct echo_config : ipv4::default_config
+{
+  static constexpr uint32_t    arp_entry_lifetime       = 10 * c_count;
+};
+
+struct host_config : echo_config
+{
+  static constexpr std::size_t interface_table_size     = 1;
+  static constexpr std::size_t udp_ports_table_size     = 64;
+  static constexpr std::size_t port_rx_queue_size       = 8;
+  static constexpr std::size_t buffer_descriptor_size   = 512;
+  static constexpr std::size_t frame_pool_size          = 65536U;
+};
+
+const ethernet::address c_local_hw_addr = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+const ethernet::address c_peer_hw_addr  = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+/// UDP datagram of 18 bytes from 10.0.0.1:8000 to 10.0.0.2:8000 without
+/// a UDP checksum, padded to the minimum frame size
+std::vector<uint8_t>
+datagram_frame()
+{
+  std::vector<uint8_t> f =
+  {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x02,   0x02, 0x00, 0x00, 0x00, 0x00, 0x01,   0x08, 0x00,
+    0x45, 0x00, 0x00, 0x2E,   0x00, 0x01, 0x40, 0x00,   0x40, 0x11, 0x00, 0x00,
+    10, 0, 0, 1,   10, 0, 0, 2,
+    0x1F, 0x40, 0x1F, 0x40,   0x00, 0x1A, 0x00, 0x00,
+  };
+  ipv4::checksum c;
+
+  f.resize(60, 0);
+  c.append(&f[14], 20);
+
+  const uint16_t sum = c.finalize();
+
+  std::memcpy(&f[24], &sum, sizeof(sum));
+
+  return f;
+}
+
+/// Each step reads a burst of datagrams, which are received and each
+/// answered with one datagram. held transmit leases are kept allocated
+/// by the application, as if payloads were being written
+template<typename Config>
+void
+run
+(
+  const char        *name,
+  const bool        f_traffic,
+  const std::size_t held
+)
+{
+  auto                        s       = std::make_unique<ipv4::stack<Config>>();
+  const std::vector<uint8_t>  frame   = datagram_frame();
+  uint8_t                     payload[18] = {};
+
+  s->set(0, c_local_hw_addr, {10, 0, 0, 2});
+  s->interfaces()[0].arp_table.update(c_peer_hw_addr, {10, 0, 0, 1}, true);
+
+  auto ed = s->bind(0, 8000);
+
+  std::vector<ipv4::tx_lease<Config>> leases;
+
+  for (std::size_t n = 0; n < held; n++)
+  {
+    auto lease = s->acquire_tx(ed, 16);
+
+    if (lease)
+    {
+      leases.push_back(lease);
+    }
+  }
+
+  auto read = [&](ipv4::interface_designator, ipv4::frame *frames, const std::size_t count) -> std::size_t
+  {
+    for (std::size_t k = 0; k < count; k++)
+    {
+      std::memcpy(frames[k].data, frame.data(), frame.size());
+      frames[k].size = frame.size();
+    }
+
+    return count;
+  };
+
+  auto write = [](ipv4::interface_designator, const ipv4::frame*, const std::size_t count) -> std::size_t
+  {
+    return count;
+  };
+
+  const double t = measure
+  (
+    c_count,
+    [&](std::size_t)
+    {
+      s->step([f_traffic](ipv4::interface_designator) { return f_traffic; }, read, write);
+
+      for (auto lease = s->receive_view(ed); lease; lease = s->receive_view(ed))
+      {
+        s->send(ed, payload, sizeof(payload), { {10, 0, 0, 1}, 9000 });
+        s->release(lease);
+      }
+    }
+  );
+
+  row(std::string(name) + ", " + std::to_string(leases.size()) + " held" + (f_traffic ? "" : ", idle"), t);
+}
+
+} // namespace
+
+void
+bench_step()
+{
+  std::cout << "Step of one interface (ns per step)\n";
+
+  run<echo_config>("default", true, 0);
+  run<host_config>("512 descriptors", true, 0);
+  run<host_config>("512 descriptors", true, 400);
+  run<host_config>("512 descriptors", false, 400);
+}
+
+} // namespace bench
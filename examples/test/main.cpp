@@ -1,5 +1,5 @@
 // Example compile statement
-// g++ -Wall -g -I../../../haluj/include -I../../../bit/include -I../../include -I../../../include/cpp -DDEBUG -std=c++17 -o ipstack main.cpp ../../src/protocol/ipv4/stack.cpp ../../src/protocol/ipv4/bd.cpp
+// g++ -Wall -g -I../../../haluj/include -I../../../bit/include -I../../include -I../../../include/cpp -DDEBUG -std=c++17 -o ipstack main.cpp ../../src/protocol/ipv4/stack.cpp
 
 #include <iostream>
 #include <cstring>
@@ -36,35 +36,35 @@ packet g_packets[] =
     60,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x23\x92\x92\x40\x00\x40\x11\x94\x35\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\xa2\x26\x1f\x40\x00\x0f\x14\x23\x54\x45\x53\x54\x20\x31" \
+    "\x00\x02\xa2\x26\x1f\x40\x00\x0f\x58\x9c\x54\x45\x53\x54\x20\x31" \
     "\x0a\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
   },
   { // UDP 55898 -> 8000 "TEST 2\n"
     60,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x23\x83\x34\x40\x00\x40\x11\xa3\x93\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x14\x23\x54\x45\x53\x54\x20\x32"
+    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x20\x67\x54\x45\x53\x54\x20\x32"
     "\x0a\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
   },
   { // UDP 55898 -> 8000 "TEST 3\n"
     60,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x23\x83\x35\x40\x00\x40\x11\xa3\x92\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x14\x23\x54\x45\x53\x54\x20\x33"
+    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x20\x66\x54\x45\x53\x54\x20\x33"
     "\x0a\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
   },
   { // UDP 55898 -> 8000 "TEST 4\n"
     60,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x23\x83\x36\x40\x00\x40\x11\xa3\x91\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x14\x23\x54\x45\x53\x54\x20\x34"
+    "\x00\x02\xda\x5a\x1f\x40\x00\x0f\x20\x65\x54\x45\x53\x54\x20\x34"
     "\x0a\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
   },
   { // UDP 39445 -> 8000 158 bytes of data
     158,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x90\x7f\xdc\x40\x00\x40\x11\xa6\x7e\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\x9a\x15\x1f\x40\x00\x7c\x14\x90\x75\x69\x6e\x74\x38\x5f" \
+    "\x00\x02\x9a\x15\x1f\x40\x00\x7c\x50\x63\x75\x69\x6e\x74\x38\x5f" \
     "\x74\x20\x20\x20\x20\x20\x20\x20\x20\x20\x20\x20\x20\x20\x2a\x65" \
     "\x63\x68\x6f\x20\x3d\x20\x28\x75\x69\x6e\x74\x38\x5f\x74\x2a\x29" \
     "\x20\x28\x70\x74\x72\x20\x2b\x20\x73\x69\x7a\x65\x6f\x66\x28\x69" \
@@ -77,7 +77,7 @@ packet g_packets[] =
     168,
     "\xdc\x0e\xa1\x1c\x8e\x19\x1c\x6f\x65\x4a\xe2\x0f\x08\x00\x45\x00" \
     "\x00\x9a\x7f\xdd\x40\x00\x40\x11\xa6\x73\x0a\x00\x00\x01\x0a\x00" \
-    "\x00\x02\x9a\x15\x1f\x40\x00\x86\x14\x9a\x54\x52\x41\x43\x45\x28" \
+    "\x00\x02\x9a\x15\x1f\x40\x00\x86\x98\xc2\x54\x52\x41\x43\x45\x28" \
     "\x20\x5f\x5f\x46\x55\x4e\x43\x54\x49\x4f\x4e\x5f\x5f\x20\x3c\x3c" \
     "\x20\x22\x20\x70\x2e\x72\x78\x5f\x62\x75\x66\x66\x65\x72\x5f\x64" \
     "\x65\x73\x63\x72\x69\x70\x74\x6f\x72\x5f\x72\x65\x66\x73\x2e\x73" \
@@ -90,7 +90,7 @@ packet g_packets[] =
   
 };
 
-void dump(ipv4::buffer_descriptor_container& descriptors)
+void dump(ipv4::buffer_descriptor_container<>& descriptors)
 {
   std::cout << __FUNCTION__ << "\n";
 
@@ -110,28 +110,32 @@ void step(std::optional<std::size_t> packet_index = std::nullopt)
 {
   protocol::ipv4::step
   (
-    // Receive Frame Available
-    [packet_index]() -> bool 
+    // Receive Frame Available (test packets arrive on interface 0)
+    [packet_index](ipv4::interface_designator id) -> bool 
     {
-      return packet_index.has_value();
+      return (id == 0) && packet_index.has_value();
     },
-    // Read
-    [packet_index](auto &b, const std::size_t max_size) -> std::size_t 
+    // Read, a single test packet per burst
+    [packet_index](ipv4::interface_designator id, ipv4::frame *frames, const std::size_t count) -> std::size_t 
     {
       std::size_t result = 0;
-      if (g_packets[*packet_index].size <= max_size)
+      if ((id == 0) && count > 0 && g_packets[*packet_index].size <= frames[0].capacity)
       {
-        result = g_packets[*packet_index].size;
-        std::memcpy(&b[0], g_packets[*packet_index].data, result);
-        std::cout << "Read :" << result << " byte(s)\n";
+        frames[0].size = g_packets[*packet_index].size;
+        std::memcpy(frames[0].data, g_packets[*packet_index].data, frames[0].size);
+        std::cout << "Read :" << frames[0].size << " byte(s)\n";
+        result = 1;
       }
       return result;
     },
-    // Write
-    [packet_index](auto &b, const std::size_t size) -> std::size_t 
+    // Write, all frames queued in the step
+    [packet_index](ipv4::interface_designator id, const ipv4::frame *frames, const std::size_t count) -> std::size_t 
     {
-      std::cout << "Write :" << size << " byte(s)\n";
-      return size;
+      for (std::size_t k = 0; k < count; k++)
+      {
+        std::cout << "Write (" << id << ") :" << frames[k].size << " byte(s)\n";
+      }
+      return count;
     }
   );
   
@@ -152,16 +156,14 @@ void test_ip()
     )
   )
   {
-    auto &in = protocol::ipv4::g_interfaces[0];
+    auto &in = protocol::ipv4::g_stack.interfaces()[0];
     
     std::cout << "Interface:" << 0 << "\n";
     std::cout << "HW ADDR:" << in.hw_addr << "\n";
     std::cout << "IP ADDR:" << in.ip_addr << "\n";
   }
 
-  uint8_t   paket[2048];
-  
-  auto &intf = protocol::ipv4::g_interfaces[0];
+  auto &intf = protocol::ipv4::g_stack.interfaces()[0];
   std::cout << "============= ARP\n";
   
   dump(intf.rx_buffer_descriptors);
@@ -205,14 +207,15 @@ void test_ip()
 
   step(3);
 
-  l = ipv4::udp::received_length(ed);
-
-  ipv4::udp::receive(ed, buffer, l, remote);
+  // Zero copy receive, payload is read from the buffer descriptor
+  auto lease = ipv4::udp::receive_view(ed);
 
-  std:: cout << "=> rx length:" << l << "("<< std::string(buffer, buffer + l) <<")\n";
+  std:: cout << "=> rx length:" << lease.size << "("<< std::string(lease.data, lease.data + lease.size) <<")\n";
   std:: cout << "-------> send echo\n";
   
-  ipv4::udp::send(ed, buffer, l, remote);
+  ipv4::udp::send(ed, lease.data, lease.size, lease.remote);
+  
+  ipv4::udp::release(lease);
 
   step();
 
@@ -222,12 +225,15 @@ void test_ip()
 
   l = ipv4::udp::received_length(ed);
 
-  ipv4::udp::receive(ed, buffer, l, remote);
+  // Zero copy transmit, payload is received into the transmit descriptor
+  auto tx = ipv4::udp::acquire_tx(ed, l);
 
-  std:: cout << "=> rx length:" << l << "("<< std::string(buffer, buffer + l) <<")\n";
+  ipv4::udp::receive(ed, tx.data, tx.size, remote);
+
+  std:: cout << "=> rx length:" << l << "("<< std::string(tx.data, tx.data + tx.size) <<")\n";
   std:: cout << "-------> send echo\n";
   
-  ipv4::udp::send(ed, buffer, l, remote);
+  ipv4::udp::commit_tx(tx, remote);
 
   step();
 
@@ -277,6 +283,13 @@ void test_ip()
   ipv4::udp::receive(ed, buffer, l, remote);
 
   std:: cout << "=> rx length:" << l << "("<< std::string(buffer, buffer + l) <<")\n";
+
+  auto st = protocol::ipv4::g_stack.pool().statistics();
+  
+  std::cout << "Frame pool used:" << st.used 
+            << " high water:" << st.high_water 
+            << " largest free:" << st.largest_free 
+            << " failures:" << st.failures << "\n";
 }
 
 int main()
@@ -0,0 +1,159 @@
+/// \file allocator.cpp
+/// Allocation, release, shrinking and merging of payload buffers
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+typedef ipv4::payload_allocator<8192> allocator_type;
+
+struct block
+{
+  uint8_t     *ptr;
+  std::size_t size;
+  uint8_t     seed;
+};
+
+uint32_t
+next_random
+(
+  uint32_t& state
+)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+
+  return state;
+}
+
+/// The pattern written to the block at allocation is intact
+bool
+is_intact
+(
+  const block&  b
+)
+{
+  return bytes(b.ptr, b.ptr + b.size) == pattern(b.size, b.seed);
+}
+
+} // namespace
+
+void
+test_allocator()
+{
+  {
+    auto a = std::make_unique<allocator_type>();
+
+    CHECK(a->statistics().capacity == 8192);
+    CHECK(a->statistics().largest_free == 8192);
+
+    // Blocks are multiples of the granule, header included
+    uint8_t *p = a->allocate(100);
+    uint8_t *q = a->allocate(12);
+
+    CHECK(p != nullptr && q != nullptr && a->contains(p) && a->contains(q));
+    CHECK(q - p == std::ptrdiff_t(ipv4::payload_allocation_size(100)));
+    CHECK(a->statistics().used == ipv4::payload_allocation_size(100) + ipv4::payload_allocation_size(12));
+    CHECK(a->statistics().allocations == 2);
+
+    // Shrinking releases the end of the block, the space is taken by the
+    // next allocation
+    a->shrink(p, 20);
+    CHECK(a->statistics().used == ipv4::payload_allocation_size(20) + ipv4::payload_allocation_size(12));
+
+    uint8_t *r = a->allocate(40);
+
+    CHECK(r == p + ipv4::payload_allocation_size(20));
+
+    // Released blocks merge with both neighbours
+    a->release(p);
+    a->release(q);
+    CHECK(a->statistics().largest_free < 8192);
+    a->release(r);
+    CHECK(a->statistics().used == 0);
+    CHECK(a->statistics().largest_free == 8192);
+    CHECK(a->statistics().high_water == ipv4::payload_allocation_size(100) + ipv4::payload_allocation_size(12));
+
+    // An allocation larger than the buffer fails and is counted
+    CHECK(a->allocate(8192) == nullptr);
+    CHECK(a->statistics().failures == 1);
+    CHECK(a->allocate(8192 - 4) != nullptr);
+    CHECK(a->allocate(1) == nullptr);
+  }
+
+  {
+    // Random allocations, shrinks and releases. Blocks do not overlap,
+    // the statistics add up, and the buffer merges back to a single
+    // block once everything is released
+    auto                a         = std::make_unique<allocator_type>();
+    std::vector<block>  live;
+    uint32_t            state     = 2463534242U;
+    std::size_t         used      = 0;
+    bool                f_intact  = true;
+    bool                f_used    = true;
+
+    for (std::size_t n = 0; n < 200000; n++)
+    {
+      const uint32_t op = next_random(state) % 8;
+
+      if (op < 4 || live.empty())
+      {
+        const std::size_t size  = 1 + next_random(state) % 1500;
+        uint8_t           *ptr  = a->allocate(size);
+
+        if (ptr)
+        {
+          block b = { ptr, size, uint8_t(n) };
+
+          std::memcpy(ptr, pattern(size, b.seed).data(), size);
+          live.push_back(b);
+          used += ipv4::payload_allocation_size(size);
+        }
+      }
+      else if (op < 5)
+      {
+        block &b = live[next_random(state) % live.size()];
+
+        f_intact  = f_intact && is_intact(b);
+        used     -= ipv4::payload_allocation_size(b.size);
+        b.size    = 1 + next_random(state) % b.size;
+        used     += ipv4::payload_allocation_size(b.size);
+
+        a->shrink(b.ptr, b.size);
+      }
+      else
+      {
+        const std::size_t k = next_random(state) % live.size();
+
+        f_intact  = f_intact && is_intact(live[k]);
+        used     -= ipv4::payload_allocation_size(live[k].size);
+        a->release(live[k].ptr);
+        live[k]   = live.back();
+        live.pop_back();
+      }
+
+      f_used = f_used && (a->statistics().used == used);
+    }
+
+    for (auto &b : live)
+    {
+      f_intact = f_intact && is_intact(b);
+      a->release(b.ptr);
+    }
+
+    CHECK(f_intact);
+    CHECK(f_used);
+    CHECK(a->statistics().used == 0);
+    CHECK(a->statistics().largest_free == 8192);
+    CHECK(a->statistics().failures > 0);
+  }
+}
+
+} // namespace unit
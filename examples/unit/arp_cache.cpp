@@ -0,0 +1,162 @@
+/// \file arp_cache.cpp
+/// Lookup, aging and replacement of the ARP cache
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+ethernet::address
+hw_address
+(
+  const uint32_t  n
+)
+{
+  return { 0x02, 0x00, uint8_t(n >> 24), uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n) };
+}
+
+ipv4::address
+ip_address
+(
+  const uint32_t  n
+)
+{
+  return { 10, uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n) };
+}
+
+struct short_lived_config : ipv4::default_config
+{
+  static constexpr uint32_t    arp_entry_lifetime       = 5;
+};
+
+} // namespace
+
+void
+test_arp_cache()
+{
+  {
+    ipv4::arp_cache<ipv4::arp_table_entry, 8, 8, 100, 10>  cache;
+
+    CHECK(!cache.find(ip_address(1)).has_value());
+
+    auto e_ref = cache.update(hw_address(1), ip_address(1), true);
+
+    CHECK(e_ref && e_ref->get().is_complete());
+    CHECK(cache.find(ip_address(1)) && cache.find(ip_address(1))->get().hw_addr == hw_address(1));
+
+    // A refresh of the same mapping keeps the generation, a change or a
+    // removal advances it
+    uint32_t g = cache.generation();
+
+    cache.update(hw_address(1), ip_address(1), true);
+    CHECK(cache.generation() == g);
+    cache.update(hw_address(2), ip_address(1), true);
+    CHECK(cache.generation() != g);
+    CHECK(cache.find(ip_address(1))->get().hw_addr == hw_address(2));
+
+    g = cache.generation();
+    cache.remove(ip_address(1));
+    CHECK(cache.generation() != g);
+    CHECK(!cache.find(ip_address(1)).has_value());
+
+    // Complete entries expire after their lifetime from the last update,
+    // incomplete ones after the incomplete lifetime
+    cache.update(hw_address(3), ip_address(3), true);
+    cache.update(c_broadcast, ip_address(4), false);
+
+    for (int k = 0; k < 10; k++)
+    {
+      cache.tick();
+    }
+
+    CHECK(cache.find(ip_address(3)).has_value());
+    CHECK(!cache.find(ip_address(4)).has_value());
+
+    for (int k = 0; k < 50; k++)
+    {
+      cache.tick();
+    }
+
+    cache.update(hw_address(3), ip_address(3), true);
+
+    for (int k = 0; k < 99; k++)
+    {
+      cache.tick();
+    }
+
+    CHECK(cache.find(ip_address(3)).has_value());
+    cache.tick();
+    CHECK(!cache.find(ip_address(3)).has_value());
+  }
+
+  {
+    // The probe window covers the cache. When it is full, an entry not
+    // referenced since the last sweep is replaced
+    ipv4::arp_cache<ipv4::arp_table_entry, 8, 8, 100, 10>  cache;
+
+    for (uint32_t n = 0; n < 8; n++)
+    {
+      cache.update(hw_address(n), ip_address(n), true);
+    }
+
+    for (uint32_t n = 0; n < 7; n++)
+    {
+      CHECK(cache.find(ip_address(n)).has_value());
+    }
+
+    CHECK(cache.update(hw_address(8), ip_address(8), true).has_value());
+    CHECK(cache.find(ip_address(8)).has_value());
+    CHECK(!cache.find(ip_address(7)).has_value());
+
+    std::size_t found = 0;
+
+    for (uint32_t n = 0; n < 7; n++)
+    {
+      found += cache.find(ip_address(n)) ? 1 : 0;
+    }
+
+    CHECK(found == 7);
+  }
+
+  {
+    // Insertion never fails once the cache is full, the latest entries are
+    // found and each mapping is kept once
+    auto cache = std::make_unique<ipv4::arp_cache<ipv4::arp_table_entry, 4096, 8>>();
+
+    for (uint32_t n = 0; n < 20000; n++)
+    {
+      CHECK(cache->update(hw_address(n), ip_address(n), true).has_value());
+    }
+
+    CHECK(cache->find(ip_address(19999)) && cache->find(ip_address(19999))->get().hw_addr == hw_address(19999));
+
+    cache->update(hw_address(1), ip_address(19999), true);
+    cache->remove(ip_address(19999));
+    CHECK(!cache->find(ip_address(19999)).has_value());
+  }
+
+  {
+    // Entries of an interface age with the steps of the stack
+    auto  s = std::make_unique<ipv4::stack<short_lived_config>>();
+    wire  w(*s);
+
+    s->set(0, c_local.hw_addr, c_local.ip_addr);
+    resolve(w, 0, c_peer, c_local);
+
+    CHECK(s->interfaces()[0].arp_table.find(c_peer.ip_addr).has_value());
+
+    for (int k = 0; k < 5; k++)
+    {
+      w.step();
+    }
+
+    CHECK(!s->interfaces()[0].arp_table.find(c_peer.ip_addr).has_value());
+  }
+}
+
+} // namespace unit
@@ -0,0 +1,163 @@
+/// \file arp_resolution.cpp
+/// Packets are held while their next hop is resolved
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct holding_config : ipv4::default_config
+{
+  static constexpr std::size_t buffer_descriptor_size   = 8U;
+  static constexpr std::size_t arp_pending_table_size   = 1;
+  static constexpr std::size_t arp_hold_queue_size      = 3;
+};
+
+/// Number of ARP requests for the address in the frames
+std::size_t
+arp_requests
+(
+  const std::vector<bytes>& frames,
+  const ipv4::address&      a
+)
+{
+  std::size_t result = 0;
+
+  for (auto &f : frames)
+  {
+    if (field(f, 12) == 0x0806 && field(f, 20) == 1 && std::equal(a.begin(), a.end(), f.begin() + 38))
+    {
+      result++;
+    }
+  }
+
+  return result;
+}
+
+/// Number of UDP frames
+std::size_t
+udp_frames
+(
+  const std::vector<bytes>& frames
+)
+{
+  std::size_t result = 0;
+
+  for (auto &f : frames)
+  {
+    result += is_valid_udp_frame(f) ? 1 : 0;
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_arp_resolution()
+{
+  {
+    auto  s   = std::make_unique<ipv4::stack<holding_config>>();
+    wire  w(*s);
+    auto  &st = s->interfaces()[0].statistics;
+
+    s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+    auto ed = s->bind(0, 8000);
+
+    // Packets to an unresolved next hop are held, a single request is
+    // written for them
+    for (uint8_t k = 0; k < 3; k++)
+    {
+      CHECK(s->send(ed, pattern(10, k).data(), 10, { c_peer.ip_addr, 8001 }) == 10);
+    }
+
+    w.step();
+    w.step();
+
+    CHECK(arp_requests(w.tx[0], c_peer.ip_addr) == 1);
+    CHECK(udp_frames(w.tx[0]) == 0);
+
+    // The hold queue takes no more packets
+    CHECK(s->send(ed, pattern(10, 3).data(), 10, { c_peer.ip_addr, 8001 }) == 10);
+    w.step();
+    CHECK(st.arp_hold_drops == 1);
+
+    // The reply releases the held packets together, in the order sent
+    w.tx[0].clear();
+    w.rx[0].push_back(arp_frame(2, c_peer, c_local, c_local.hw_addr));
+    w.step();
+
+    CHECK(udp_frames(w.tx[0]) == 3);
+
+    for (uint8_t k = 0; k < 3 && k < w.tx[0].size(); k++)
+    {
+      CHECK(udp_payload(w.tx[0][k]) == pattern(10, k));
+      CHECK(bytes(w.tx[0][k].begin(), w.tx[0][k].begin() + 6) == bytes(c_peer.hw_addr.begin(), c_peer.hw_addr.end()));
+    }
+  }
+
+  {
+    auto                  s     = std::make_unique<ipv4::stack<holding_config>>();
+    wire                  w(*s);
+    auto                  &st   = s->interfaces()[0].statistics;
+    const ipv4::address   other = {10, 0, 0, 3};
+
+    s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+    auto ed = s->bind(0, 8000);
+
+    // A resolution is retried after 50, 100 and 200 more steps, then its
+    // packets are dropped
+    CHECK(s->send(ed, pattern(10, 0).data(), 10, { c_peer.ip_addr, 8001 }) == 10);
+    w.step();
+    CHECK(arp_requests(w.tx[0], c_peer.ip_addr) == 1);
+
+    // The resolution table is full, a packet to another next hop is dropped
+    CHECK(s->send(ed, pattern(10, 1).data(), 10, { other, 8001 }) == 10);
+    w.step();
+    CHECK(st.arp_hold_drops == 1);
+    CHECK(arp_requests(w.tx[0], other) == 0);
+
+    std::size_t steps = 2;
+    std::size_t at[4] = {};
+
+    for (std::size_t n = 1; n < 4; n++)
+    {
+      while (arp_requests(w.tx[0], c_peer.ip_addr) == n && steps < 1000)
+      {
+        w.step();
+        steps++;
+      }
+
+      at[n] = steps;
+    }
+
+    CHECK(st.arp_requests == 4);
+    CHECK(at[2] - at[1] == 100 && at[3] - at[2] == 200);
+    CHECK(st.arp_resolution_drops == 0);
+
+    while (st.arp_resolution_drops == 0 && steps < 2000)
+    {
+      w.step();
+      steps++;
+    }
+
+    CHECK(steps - at[3] == 400);
+    CHECK(st.arp_resolution_drops == 1);
+    CHECK(st.arp_requests == 4);
+    CHECK(udp_frames(w.tx[0]) == 0);
+
+    // The resolution is free for the next packet
+    CHECK(s->send(ed, pattern(10, 2).data(), 10, { other, 8001 }) == 10);
+    w.step();
+    CHECK(arp_requests(w.tx[0], other) == 1);
+  }
+}
+
+} // namespace unit
@@ -0,0 +1,91 @@
+/// \file burst.cpp
+/// Frames are read in bursts, each frame of a burst is processed
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_burst()
+{
+  auto                s     = std::make_unique<ipv4::stack<>>();
+  wire                w(*s);
+  const std::size_t   burst = ipv4::default_config::rx_burst_size;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto              ed    = s->bind(0, 8000);
+  const std::size_t used  = s->pool().statistics().used;
+
+  // A burst is read with a single call, and the replies to each of its
+  // frames are written together
+  for (uint8_t k = 0; k < burst; k++)
+  {
+    const host peer = { c_peer.hw_addr, {10, 0, 0, uint8_t(10 + k)} };
+
+    w.rx[0].push_back(arp_frame(1, peer, c_local, c_broadcast));
+  }
+
+  w.step();
+
+  CHECK(w.reads == 1 && w.writes == 1);
+  CHECK(w.rx[0].empty());
+  CHECK(w.tx[0].size() == burst);
+
+  for (uint8_t k = 0; k < burst && k < w.tx[0].size(); k++)
+  {
+    CHECK(field(w.tx[0][k], 20) == 2 && w.tx[0][k][41] == 10 + k);
+  }
+
+  // Frames beyond a burst wait for the next step
+  w.tx[0].clear();
+
+  for (uint8_t k = 0; k < burst + 2; k++)
+  {
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, k)));
+  }
+
+  w.step();
+  CHECK(w.rx[0].size() == 2);
+  CHECK(s->received_length(ed) == 10);
+
+  // Frames of different protocols in a burst are each handled
+  w.rx[0].clear();
+  s->unbind(ed);
+  ed = s->bind(0, 8000);
+
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1));
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 2)));
+  w.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 3), 2));
+  w.step();
+
+  CHECK(w.tx[0].size() == 3);
+
+  if (w.tx[0].size() == 3)
+  {
+    CHECK(is_valid_ip_frame(w.tx[0][0]) && w.tx[0][0][23] == 1 && field(w.tx[0][0], 40) == 1);
+    CHECK(field(w.tx[0][1], 12) == 0x0806);
+    CHECK(is_valid_ip_frame(w.tx[0][2]) && w.tx[0][2][23] == 1 && field(w.tx[0][2], 40) == 2);
+  }
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(lease.size == 10 && lease.data[0] == 2);
+  s->release(lease);
+
+  // The blocks of a burst not filled by the driver are returned
+  w.tx[0].clear();
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 4)));
+  w.step();
+
+  lease = s->receive_view(ed);
+  CHECK(lease.size == 10 && lease.data[0] == 4);
+  s->release(lease);
+  CHECK(s->pool().statistics().used == used);
+}
+
+} // namespace unit
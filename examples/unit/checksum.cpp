@@ -0,0 +1,121 @@
+/// \file checksum.cpp
+/// Checksum kernels agree with a reference summed one word at a time
+
+#include <iostream>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+typedef uint64_t (*kernel)(uint64_t, const void*, std::size_t);
+
+struct named_kernel
+{
+  const char  *name;
+  kernel      add;
+};
+
+/// Kernels built for the target, checksum_add selects the last one
+const named_kernel g_kernels[] =
+{
+  { "portable", ipv4::checksum_add_portable },
+#if defined(__SSE2__)
+  { "sse2",     ipv4::checksum_add_sse2 },
+#endif
+#if defined(__AVX2__)
+  { "avx2",     ipv4::checksum_add_avx2 },
+#endif
+#if defined(__ARM_NEON)
+  { "neon",     ipv4::checksum_add_neon },
+#endif
+};
+
+/// Checksum of the kernel in network order, as the reference
+uint16_t
+kernel_checksum
+(
+  const kernel      add,
+  const uint8_t     *data,
+  const std::size_t size
+)
+{
+  const uint16_t  c = uint16_t(~ipv4::checksum_fold(add(0U, data, size)));
+  uint8_t         b[2];
+
+  std::memcpy(b, &c, sizeof(c));
+
+  return uint16_t((b[0] << 8) | b[1]);
+}
+
+bool
+agrees
+(
+  const kernel  add,
+  const bytes&  data
+)
+{
+  bool result = true;
+
+  // Sizes from none to a few vectors, a frame and a jumbo frame, at each
+  // alignment up to a vector
+  for (std::size_t offset = 0; offset < 32; offset++)
+  {
+    for (std::size_t size = 0; offset + size <= data.size(); size = (size < 300) ? size + 1 : size * 2 + 1)
+    {
+      result = result && (kernel_checksum(add, &data[offset], size) == reference_checksum(&data[offset], size));
+    }
+
+    result = result && (kernel_checksum(add, &data[offset], 1500) == reference_checksum(&data[offset], 1500));
+    result = result && (kernel_checksum(add, &data[offset], 9000) == reference_checksum(&data[offset], 9000));
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_checksum()
+{
+  bytes random_data(9100);
+  bytes ones(9100, 0xFF);
+
+  uint32_t state = 2463534242U;
+
+  for (auto &b : random_data)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    b      = uint8_t(state);
+  }
+
+  for (auto &k : g_kernels)
+  {
+    if (!CHECK(agrees(k.add, random_data)) || !CHECK(agrees(k.add, ones)))
+    {
+      std::cout << "  kernel " << k.name << "\n";
+    }
+  }
+
+  // The selected kernel adds blocks of even size to a running sum like a
+  // single block
+  uint64_t sum = 0U;
+
+  for (std::size_t k = 0; k < 9000; k += 250)
+  {
+    sum = ipv4::checksum_add(sum, &random_data[k + 1], 250);
+  }
+
+  CHECK(ipv4::checksum_fold(sum) == ipv4::checksum_fold(ipv4::checksum_add(0U, &random_data[1], 9000)));
+
+  // The fold of a sum near the limit of the accumulator wraps the carries
+  CHECK(ipv4::checksum_fold(0xFFFFFFFFFFFFFFFFULL) == 0xFFFF);
+  CHECK(ipv4::checksum_fold(0x0001000000000000ULL) == 0x0001);
+}
+
+} // namespace unit
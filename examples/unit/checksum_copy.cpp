@@ -0,0 +1,166 @@
+/// \file checksum_copy.cpp
+/// Payloads are summed while they are copied, on transmission and on
+/// reception
+
+#include <iostream>
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+typedef uint64_t (*copy_kernel)(uint64_t, void*, const void*, std::size_t);
+
+struct named_kernel
+{
+  const char  *name;
+  copy_kernel copy;
+};
+
+const named_kernel g_kernels[] =
+{
+  { "portable", ipv4::checksum_copy_portable },
+#if defined(__SSE2__)
+  { "sse2",     ipv4::checksum_copy_sse2 },
+#endif
+#if defined(__AVX2__)
+  { "avx2",     ipv4::checksum_copy_avx2 },
+#endif
+#if defined(__ARM_NEON)
+  { "neon",     ipv4::checksum_copy_neon },
+#endif
+};
+
+/// The kernel copies the data exactly, leaves the bytes around the copy
+/// as they are, and sums like checksum_add
+bool
+copies
+(
+  const copy_kernel add,
+  const bytes&      data
+)
+{
+  bool result = true;
+
+  for (std::size_t offset = 0; offset < 32; offset++)
+  {
+    for (std::size_t size = 0; size + 64 <= data.size(); size = (size < 300) ? size + 1 : size * 2 + 1)
+    {
+      bytes           dest(size + 64, 0x5A);
+      const uint64_t  sum = add(0U, &dest[31 - offset % 16], &data[offset], size);
+
+      result = result && std::equal(&data[offset], &data[offset] + size, &dest[31 - offset % 16]);
+      result = result && (dest[30 - offset % 16] == 0x5A) && (dest[31 - offset % 16 + size] == 0x5A);
+      result = result && (ipv4::checksum_fold(sum) == ipv4::checksum_fold(ipv4::checksum_add(0U, &data[offset], size)));
+    }
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_checksum_copy()
+{
+  {
+    const bytes data = pattern(9100, 3);
+
+    for (auto &k : g_kernels)
+    {
+      if (!CHECK(copies(k.copy, data)))
+      {
+        std::cout << "  kernel " << k.name << "\n";
+      }
+    }
+  }
+
+  auto  s   = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+  auto  &st = s->interfaces()[0].statistics;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto ed = s->bind(0, 8000);
+
+  // Datagrams sent have valid checksums at every size
+  bool f_valid = true;
+
+  for (std::size_t size = 1; size <= 1472; size += 37)
+  {
+    const bytes p = pattern(size, uint8_t(size));
+
+    s->send(ed, p.data(), p.size(), { c_peer.ip_addr, 8001 });
+    w.step();
+
+    f_valid = f_valid && (w.tx[0].size() == 1) && is_valid_udp_frame(w.tx[0][0]);
+    f_valid = f_valid && (field(w.tx[0][0], 40) != 0) && (udp_payload(w.tx[0][0]) == p);
+
+    w.tx[0].clear();
+  }
+
+  CHECK(f_valid);
+
+  // A checksum computed as zero is sent as all ones. The payload word
+  // equal to the checksum of a zero payload brings the sum to zero
+  const uint8_t zero[2] = { 0, 0 };
+
+  s->send(ed, zero, 2, { c_peer.ip_addr, 8001 });
+  w.step();
+
+  const uint16_t  c         = field(w.tx[0].at(0), 40);
+  const uint8_t   cancel[2] = { uint8_t(c >> 8), uint8_t(c) };
+
+  w.tx[0].clear();
+  s->send(ed, cancel, 2, { c_peer.ip_addr, 8001 });
+  w.step();
+
+  CHECK(field(w.tx[0].at(0), 40) == 0xFFFF);
+  CHECK(is_valid_udp_frame(w.tx[0].at(0)));
+
+  // Datagrams received are verified while they are copied. A bad
+  // checksum drops the datagram and is counted, a zero checksum is not
+  // verified
+  bool f_received = true;
+
+  for (std::size_t size = 1; size <= 1472; size += 37)
+  {
+    const bytes     p = pattern(size, uint8_t(size));
+    uint8_t         buffer[1472];
+    ipv4::endpoint  remote;
+
+    w.rx[0].push_back(udp_frame(c_peer, c_local, p));
+    w.step();
+
+    f_received = f_received && (s->receive(ed, buffer, sizeof(buffer), remote) == size);
+    f_received = f_received && (bytes(buffer, buffer + size) == p);
+  }
+
+  CHECK(f_received);
+  CHECK(st.udp_checksum_errors == 0);
+
+  udp_options bad;
+  udp_options none;
+
+  bad.bad_checksum  = true;
+  none.no_checksum  = true;
+
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(101, 1), bad));
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(101, 2), none));
+  w.step();
+
+  CHECK(st.udp_checksum_errors == 1);
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(lease.size == 101 && lease.data[0] == 2);
+  s->release(lease);
+  CHECK(s->received_length(ed) == 0);
+}
+
+} // namespace unit
@@ -0,0 +1,74 @@
+/// \file config.cpp
+/// Stacks sized and trimmed by their configuration
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct quiet_config : ipv4::default_config
+{
+  static constexpr std::size_t interface_table_size     = 2;
+  static constexpr std::size_t udp_ports_table_size     = 2;
+  static constexpr bool        icmp_enabled             = false;
+  static constexpr bool        arp_reply_enabled        = false;
+  static constexpr bool        udp_checksum_enabled     = false;
+};
+
+} // namespace
+
+void
+test_config()
+{
+  // The tables are sized by the configuration
+  auto  s = std::make_unique<ipv4::stack<quiet_config>>();
+  wire  w(*s);
+
+  CHECK(s->interfaces().size() == 2);
+  CHECK(!s->set(2, c_local.hw_addr, c_local.ip_addr));
+  CHECK(s->set(0, c_local.hw_addr, c_local.ip_addr));
+
+  auto ed = s->bind(0, 8000);
+
+  CHECK(ed.has_value() && s->bind(0, 8001).has_value());
+  CHECK(!s->bind(0, 8002).has_value());
+
+  // Echo requests and ARP requests are not answered, the address of the
+  // peer is still learned from its request
+  w.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1));
+  w.step();
+
+  CHECK(w.tx[0].empty());
+
+  // Datagrams are sent without a checksum, straight to the peer
+  s->send(ed, pattern(100, 2).data(), 100, { c_peer.ip_addr, 8001 });
+  w.step();
+
+  CHECK(w.tx[0].size() == 1);
+
+  if (w.tx[0].size() == 1)
+  {
+    CHECK(is_valid_ip_frame(w.tx[0][0]) && field(w.tx[0][0], 40) == 0);
+    CHECK(std::equal(c_peer.hw_addr.begin(), c_peer.hw_addr.end(), w.tx[0][0].begin()));
+    CHECK(udp_payload(w.tx[0][0]) == pattern(100, 2));
+  }
+
+  // and received without verification
+  udp_options bad;
+
+  bad.bad_checksum = true;
+
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 3), bad));
+  w.step();
+
+  CHECK(s->received_length(ed) == 10);
+  CHECK(s->interfaces()[0].statistics.udp_checksum_errors == 0);
+}
+
+} // namespace unit
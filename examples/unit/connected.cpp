@@ -0,0 +1,182 @@
+/// \file connected.cpp
+/// Datagrams of connected ports are formed from header templates
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+/// The frames are the same but for the identification and the IP header
+/// checksum
+bool
+is_same_datagram
+(
+  const bytes&  a,
+  const bytes&  b
+)
+{
+  bool result = (a.size() == b.size());
+
+  for (std::size_t k = 0; result && k < a.size(); k++)
+  {
+    result = (k == 18 || k == 19 || k == 24 || k == 25 || a[k] == b[k]);
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_connected()
+{
+  auto              s       = std::make_unique<ipv4::stack<>>();
+  wire              w(*s);
+  const host        peer_1  = { {0x02, 0x00, 0x00, 0x00, 0x01, 0x01}, {10, 0, 1, 1} };
+  const ipv4::endpoint remote = { c_peer.ip_addr, 9000 };
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  s->set(1, c_local_1.hw_addr, c_local_1.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+  resolve(w, 1, peer_1, c_local_1);
+
+  auto ed = s->bind(0, 8000);
+
+  // Without a connection there is no remote to send to
+  CHECK(s->send(ed, pattern(10, 1).data(), 10) == 0);
+
+  auto lease = s->acquire_tx(ed, 10);
+
+  CHECK(s->commit_tx(lease) == 0 && !lease);
+  w.step();
+  CHECK(w.tx[0].empty());
+
+  // Frames of a connected port are those of the regular path, through
+  // send and through a lease
+  CHECK(s->connect(ed, remote));
+
+  for (std::size_t size : { 1, 2, 57, 1472 })
+  {
+    const bytes p = pattern(size, uint8_t(size));
+
+    s->send(ed, p.data(), size, remote);
+    w.step();
+    s->send(ed, p.data(), size);
+    w.step();
+
+    lease = s->acquire_tx(ed, size);
+
+    if (lease)
+    {
+      std::memcpy(lease.data, p.data(), size);
+    }
+
+    CHECK(s->commit_tx(lease) == size);
+    w.step();
+
+    CHECK(w.tx[0].size() == 3);
+
+    if (w.tx[0].size() == 3)
+    {
+      CHECK(is_valid_udp_frame(w.tx[0][1]) && is_valid_udp_frame(w.tx[0][2]));
+      CHECK(is_same_datagram(w.tx[0][0], w.tx[0][1]) && is_same_datagram(w.tx[0][0], w.tx[0][2]));
+      CHECK(field(w.tx[0][0], 18) != field(w.tx[0][1], 18));
+    }
+
+    w.tx[0].clear();
+  }
+
+  // A new hardware address of the remote is taken by the flow
+  const host moved = { {0x02, 0x00, 0x00, 0x00, 0x00, 0x09}, c_peer.ip_addr };
+
+  w.rx[0].push_back(arp_frame(1, moved, c_local, c_broadcast));
+  w.step();
+  w.tx[0].clear();
+
+  s->send(ed, pattern(10, 1).data(), 10);
+  w.step();
+
+  CHECK(w.tx[0].size() == 1 && std::equal(moved.hw_addr.begin(), moved.hw_addr.end(), w.tx[0].at(0).begin()));
+
+  // The template follows a new address of the interface
+  const ipv4::address renumbered = {10, 0, 0, 7};
+
+  w.tx[0].clear();
+  s->set(0, c_local.hw_addr, renumbered);
+  s->send(ed, pattern(10, 1).data(), 10);
+  w.step();
+
+  CHECK(w.tx[0].size() == 1 && is_valid_udp_frame(w.tx[0].at(0)));
+  CHECK(std::equal(renumbered.begin(), renumbered.end(), w.tx[0].at(0).begin() + 26));
+
+  // A disconnected port has no remote again
+  s->disconnect(ed);
+  CHECK(s->send(ed, pattern(10, 1).data(), 10) == 0);
+
+  // A lease held while its port is disconnected is discarded on commit,
+  // and its descriptor is free again
+  w.tx[0].clear();
+  CHECK(s->connect(ed, remote));
+
+  lease = s->acquire_tx(ed, 10);
+  CHECK(bool(lease));
+  s->disconnect(ed);
+  CHECK(s->commit_tx(lease) == 0 && !lease);
+  w.step();
+  CHECK(w.tx[0].empty());
+
+  std::vector<ipv4::tx_lease<>> leases;
+
+  for (std::size_t k = 0; k < ipv4::default_config::buffer_descriptor_size; k++)
+  {
+    leases.push_back(s->acquire_tx(ed, 10));
+    CHECK(bool(leases.back()));
+  }
+
+  for (auto &l : leases)
+  {
+    s->release(l);
+  }
+
+  // A lease held while its port is unbound is discarded on commit, even
+  // if another port takes the slot and connects to the same remote
+  CHECK(s->connect(ed, remote));
+
+  lease = s->acquire_tx(ed, 10);
+  CHECK(bool(lease));
+  CHECK(s->unbind(ed));
+
+  auto other = s->bind(0, 8200);
+
+  CHECK(other.has_value() && *other == *ed);
+  CHECK(s->connect(other, remote));
+  CHECK(s->commit_tx(lease) == 0 && !lease);
+  w.step();
+  CHECK(w.tx[0].empty());
+  CHECK(s->unbind(other));
+
+  // A port bound to all interfaces leases only once connected, through
+  // the interface routing the remote
+  auto any = s->bind(ipv4::c_any_interface, 8100);
+
+  CHECK(!s->acquire_tx(any, 10));
+  CHECK(s->connect(any, { peer_1.ip_addr, 9000 }));
+
+  w.tx[0].clear();
+  w.tx[1].clear();
+
+  lease = s->acquire_tx(any, 10);
+  CHECK(bool(lease));
+  s->commit_tx(lease);
+  w.step();
+
+  CHECK(w.tx[0].empty() && w.tx[1].size() == 1);
+  CHECK(std::equal(peer_1.hw_addr.begin(), peer_1.hw_addr.end(), w.tx[1].at(0).begin()));
+}
+
+} // namespace unit
@@ -0,0 +1,134 @@
+/// \file deliver.cpp
+/// Frames handed over by the driver, and returned through its release
+/// function
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+/// Slots of the ring of the driver, and the slots returned in order
+bytes                     g_ring[8];
+std::vector<std::size_t>  g_released;
+
+void
+release_frame
+(
+  const ipv4::frame_handle& h
+)
+{
+  g_released.push_back(reinterpret_cast<std::uintptr_t>(h.context));
+}
+
+ipv4::frame_handle
+handle
+(
+  const std::size_t slot,
+  const bytes&      f
+)
+{
+  ipv4::frame_handle result;
+
+  g_ring[slot]    = f;
+  result.data     = g_ring[slot].data();
+  result.size     = f.size();
+  result.context  = reinterpret_cast<void*>(std::uintptr_t(slot));
+
+  return result;
+}
+
+} // namespace
+
+void
+test_deliver()
+{
+  auto        s     = std::make_unique<ipv4::stack<>>();
+  wire        w(*s);
+  auto        &pool = s->pool();
+  udp_options bad;
+
+  bad.bad_checksum = true;
+  g_released.clear();
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto ed = s->bind(0, 8000);
+
+  CHECK(!s->deliver(ipv4::default_config::interface_table_size, handle(0, udp_frame(c_peer, c_local, pattern(10, 1)))));
+  CHECK(!s->set_frame_release(ipv4::default_config::interface_table_size, release_frame));
+  CHECK(s->set_frame_release(0, release_frame));
+
+  // A datagram keeps its frame, other frames are returned at once. The
+  // ARP reply is written by the next step
+  CHECK(s->deliver(0, handle(1, udp_frame(c_peer, c_local, pattern(100, 1)))));
+  CHECK(g_released.empty() && pool.statistics().used == 0);
+
+  s->deliver(0, handle(2, udp_frame(c_peer, c_local, pattern(50, 2), bad)));
+  CHECK((g_released == std::vector<std::size_t>{ 2 }));
+  CHECK(s->interfaces()[0].statistics.udp_checksum_errors == 1);
+
+  s->deliver(0, handle(3, arp_frame(1, c_peer, c_local, c_broadcast)));
+  CHECK((g_released == std::vector<std::size_t>{ 2, 3 }));
+
+  w.step();
+  CHECK(w.tx[0].size() == 1 && field(w.tx[0].at(0), 12) == 0x0806);
+  CHECK(pool.statistics().used == 0);
+
+  // The datagram is read in place and its frame returned with it, or
+  // copied out
+  s->deliver(0, handle(4, udp_frame(c_peer, c_local, pattern(1472, 4))));
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(lease.data == g_ring[1].data() + 42);
+  CHECK(bytes(lease.data, lease.data + lease.size) == pattern(100, 1));
+  CHECK(g_released.size() == 2);
+
+  s->release(lease);
+  CHECK(g_released.back() == 1);
+
+  uint8_t         buffer[1472];
+  ipv4::endpoint  remote;
+
+  CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 1472);
+  CHECK(bytes(buffer, buffer + 1472) == pattern(1472, 4));
+  CHECK(g_released.back() == 4);
+
+  // A datagram which does not fit the queue of its port is dropped, its
+  // frame returned
+  s->deliver(0, handle(5, udp_frame(c_peer, c_local, pattern(10, 5))));
+  s->deliver(0, handle(6, udp_frame(c_peer, c_local, pattern(10, 6))));
+  s->deliver(0, handle(0, udp_frame(c_peer, c_local, pattern(10, 7))));
+  CHECK(g_released.back() == 0 && g_released.size() == 5);
+
+  // Frames handed over are returned through the function they were
+  // handed over with. Without one the frame is only lent and the
+  // datagram copied to the pool
+  s->set_frame_release(0, nullptr);
+
+  for (auto l = s->receive_view(ed); l; l = s->receive_view(ed))
+  {
+    s->release(l);
+  }
+
+  CHECK(g_released.size() == 7);
+
+  s->deliver(0, handle(1, udp_frame(c_peer, c_local, pattern(20, 9))));
+  g_ring[1].assign(g_ring[1].size(), 0);
+
+  lease = s->receive_view(ed);
+
+  CHECK(pool.contains(lease.data));
+  CHECK(bytes(lease.data, lease.data + lease.size) == pattern(20, 9));
+  CHECK(g_released.size() == 7);
+
+  s->release(lease);
+  CHECK(pool.statistics().used == 0);
+}
+
+} // namespace unit
@@ -0,0 +1,152 @@
+/// \file descriptors.cpp
+/// Buffer descriptors found and visited through the bitmaps of their
+/// container
+
+#include <memory>
+#include <vector>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+/// Descriptors over three words of the bitmaps
+struct wide_config : ipv4::default_config
+{
+  static constexpr std::size_t buffer_descriptor_size   = 70;
+  static constexpr std::size_t frame_pool_size          = 65536U;
+};
+
+typedef ipv4::buffer_descriptor_container<wide_config> container_type;
+
+/// Indexes of the descriptors visited as ready
+std::vector<std::size_t>
+ready
+(
+  container_type& c
+)
+{
+  std::vector<std::size_t> result;
+
+  c.for_each_ready
+  (
+    [&](ipv4::buffer_descriptor<wide_config>& bd)
+    {
+      result.push_back(c.index_of(bd));
+    }
+  );
+
+  return result;
+}
+
+} // namespace
+
+void
+test_descriptors()
+{
+  {
+    auto c = std::make_unique<container_type>();
+
+    CHECK(c->find_free() == 0);
+    CHECK(ready(*c).empty());
+
+    // Free descriptors are found past the allocated ones, across words
+    for (std::size_t k = 0; k < 69; k++)
+    {
+      (*c)[k].flags.set<ipv4::valid>();
+      c->update((*c)[k]);
+    }
+
+    CHECK(c->find_free() == 69);
+
+    (*c)[33].flags.clear<ipv4::valid>();
+    c->update((*c)[33]);
+    CHECK(c->find_free() == 33);
+
+    (*c)[33].flags.set<ipv4::valid>();
+    (*c)[69].flags.set<ipv4::valid>();
+    c->update((*c)[33]);
+    c->update((*c)[69]);
+    CHECK(c->find_free() == c->size());
+
+    // Descriptors committed and not pending are visited in order
+    for (std::size_t k : { 64, 3, 31, 32, 69, 40 })
+    {
+      (*c)[k].flags.set<ipv4::transmit>();
+      c->update((*c)[k]);
+    }
+
+    (*c)[40].flags.set<ipv4::pending>();
+    c->update((*c)[40]);
+
+    CHECK((ready(*c) == std::vector<std::size_t>{ 3, 31, 32, 64, 69 }));
+
+    // The descriptor visited may be released
+    c->for_each_ready
+    (
+      [&](ipv4::buffer_descriptor<wide_config>& bd)
+      {
+        bd.flags = ipv4::descriptor_flags_t();
+        c->update(bd);
+      }
+    );
+
+    CHECK(ready(*c).empty());
+    CHECK(c->find_free() == 3);
+
+    (*c)[40].flags.clear<ipv4::pending>();
+    c->update((*c)[40]);
+    CHECK((ready(*c) == std::vector<std::size_t>{ 40 }));
+
+    c->reset();
+    CHECK(c->find_free() == 0 && ready(*c).empty());
+  }
+
+  // Held leases are not sent, the committed ones are, in the order of the
+  // descriptors, and freed descriptors are allocated again
+  auto  s = std::make_unique<ipv4::stack<wide_config>>();
+  wire  w(*s);
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto ed = s->bind(0, 8000);
+
+  std::vector<ipv4::tx_lease<wide_config>> leases;
+
+  for (auto lease = s->acquire_tx(ed, 10); lease; lease = s->acquire_tx(ed, 10))
+  {
+    lease.data[0] = uint8_t(leases.size());
+    leases.push_back(lease);
+  }
+
+  CHECK(leases.size() == wide_config::buffer_descriptor_size);
+
+  const auto *first_sent = &leases[2].bd_ref->get();
+
+  for (std::size_t k : { 65, 2, 40 })
+  {
+    s->commit_tx(leases[k], { c_peer.ip_addr, 8001 });
+  }
+
+  w.step();
+
+  CHECK(w.tx[0].size() == 3);
+
+  if (w.tx[0].size() == 3)
+  {
+    CHECK(udp_payload(w.tx[0][0])[0] == 2);
+    CHECK(udp_payload(w.tx[0][1])[0] == 40);
+    CHECK(udp_payload(w.tx[0][2])[0] == 65);
+  }
+
+  auto lease = s->acquire_tx(ed, 10);
+
+  CHECK(bool(lease) && &lease.bd_ref->get() == first_sent);
+  s->commit_tx(lease, { c_peer.ip_addr, 8001 });
+}
+
+} // namespace unit
@@ -0,0 +1,156 @@
+/// \file echo.cpp
+/// Incremental checksum updates and echo replies
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+uint32_t
+next_random
+(
+  uint32_t& state
+)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+
+  return state;
+}
+
+/// Checksum of the block in the order of the sums
+uint16_t
+checksum_of
+(
+  const bytes&  b
+)
+{
+  return uint16_t(~ipv4::checksum_fold(ipv4::checksum_add(0U, b.data(), b.size())));
+}
+
+bool
+is_same
+(
+  const uint16_t  a,
+  const uint16_t  b
+)
+{
+  return (a == b) || (uint16_t(a + 1) == 0 && b == 0) || (a == 0 && uint16_t(b + 1) == 0);
+}
+
+struct verifying_config : ipv4::default_config
+{
+  static constexpr bool        icmp_checksum_enabled    = true;
+};
+
+} // namespace
+
+void
+test_echo()
+{
+  {
+    // Updating a field, or a block of fields, gives the checksum of the
+    // header summed again. Zero and all ones are the same in one's
+    // complement
+    bytes     h       = pattern(20, 9);
+    uint32_t  state   = 2463534242U;
+    bool      f_same  = true;
+    uint16_t  c       = checksum_of(h);
+
+    for (std::size_t n = 0; n < 10000; n++)
+    {
+      const std::size_t offset  = 2 * (next_random(state) % 9);
+      const uint32_t    value   = next_random(state);
+      uint16_t          old_value;
+      uint16_t          new_value;
+
+      std::memcpy(&old_value, &h[offset], 2);
+      std::memcpy(&new_value, &value, 2);
+      std::memcpy(&h[offset], &new_value, 2);
+
+      c       = ipv4::checksum_update(c, old_value, new_value);
+      f_same  = f_same && is_same(c, checksum_of(h));
+
+      const bytes     old_block(h.begin() + offset, h.begin() + offset + 4);
+      const uint32_t  block = next_random(state);
+
+      std::memcpy(&h[offset], &block, 4);
+
+      c       = ipv4::checksum_update(c, old_block.data(), &h[offset], 4);
+      f_same  = f_same && is_same(c, checksum_of(h));
+    }
+
+    CHECK(f_same);
+  }
+
+  auto  s   = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+  auto  &st = s->interfaces()[0].statistics;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  // The reply carries the data, identifier and sequence of the request
+  // with a valid checksum, at even and odd data sizes
+  bool f_replied = true;
+
+  for (std::size_t size = 0; size < 100; size += 7)
+  {
+    const bytes request = icmp_echo_frame(c_peer, c_local, pattern(size, uint8_t(size)), uint16_t(size));
+
+    w.rx[0].push_back(request);
+    w.step();
+
+    f_replied = f_replied && (w.tx[0].size() == 1);
+
+    if (w.tx[0].size() == 1)
+    {
+      const bytes &r = w.tx[0][0];
+
+      f_replied = f_replied && is_valid_ip_frame(r) && (r[23] == 1) && (r[34] == 0) && (r[35] == 0);
+      f_replied = f_replied && (reference_checksum(&r[34], 8 + size) == 0);
+      f_replied = f_replied && (field(r, 38) == 0x1234) && (field(r, 40) == size);
+      f_replied = f_replied && std::equal(r.begin() + 42, r.begin() + 42 + size, request.begin() + 42);
+      f_replied = f_replied && std::equal(c_peer.hw_addr.begin(), c_peer.hw_addr.end(), r.begin());
+      f_replied = f_replied && std::equal(c_peer.ip_addr.begin(), c_peer.ip_addr.end(), r.begin() + 30);
+    }
+
+    w.tx[0].clear();
+  }
+
+  CHECK(f_replied);
+  CHECK(st.icmp_checksum_errors == 0);
+
+  // The reply to a corrupted request carries the error in its checksum
+  bytes corrupted = icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1);
+
+  corrupted[50] ^= 0x10;
+  w.rx[0].push_back(corrupted);
+  w.step();
+
+  CHECK(w.tx[0].size() == 1);
+  CHECK(w.tx[0].size() == 1 && reference_checksum(&w.tx[0][0][34], 8 + 32) != 0);
+  CHECK(st.icmp_checksum_errors == 0);
+
+  // Verifying the checksum, a corrupted request is not answered, and is
+  // counted
+  auto  v   = std::make_unique<ipv4::stack<verifying_config>>();
+  wire  vw(*v);
+
+  v->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  vw.rx[0].push_back(corrupted);
+  vw.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1));
+  vw.step();
+
+  CHECK(vw.tx[0].size() == 1);
+  CHECK(vw.tx[0].size() == 1 && reference_checksum(&vw.tx[0][0][34], 8 + 32) == 0);
+  CHECK(v->interfaces()[0].statistics.icmp_checksum_errors == 1);
+}
+
+} // namespace unit
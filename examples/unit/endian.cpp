@@ -0,0 +1,65 @@
+/// \file endian.cpp
+/// Wire fields are held in network byte order
+
+#include <type_traits>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+using ipv4::be16;
+using ipv4::be32;
+
+// Constants are converted at compile time
+static_assert(be16(0x0800).value() == 0x0800, "be16 round trip");
+static_assert(be32(0x0A000001U).value() == 0x0A000001U, "be32 round trip");
+static_assert(ipv4::byte_swap(uint16_t(0x1234)) == 0x3412, "16 bit swap");
+static_assert(ipv4::byte_swap(uint32_t(0x12345678U)) == 0x78563412U, "32 bit swap");
+static_assert(be16::from_raw(be16(0x0806).raw()) == ipv4::c_ether_type_arp, "raw round trip");
+static_assert(ipv4::c_ether_type_ipv4 != ipv4::c_ether_type_arp, "comparison");
+
+// The headers overlay the frame
+static_assert(std::is_trivial<be16>::value && std::is_trivial<be32>::value, "trivial fields");
+static_assert(sizeof(be16) == 2 && sizeof(be32) == 4, "field sizes");
+static_assert(sizeof(ipv4::eth_packet_header) == 14, "Ethernet header size");
+static_assert(sizeof(ipv4::ip_packet) == 20, "IP header size");
+static_assert(sizeof(ipv4::udp_packet) == 8, "UDP header size");
+static_assert(sizeof(ipv4::arp_packet) == 28, "ARP packet size");
+static_assert(sizeof(ipv4::icmp_packet) == 8, "ICMP header size");
+
+void
+test_endian()
+{
+  // The bytes in memory are those on the wire, most significant first
+  const be16  a(0x1234);
+  const be32  b(0x12345678U);
+  uint8_t     wire_a[2];
+  uint8_t     wire_b[4];
+
+  std::memcpy(wire_a, &a, sizeof(a));
+  std::memcpy(wire_b, &b, sizeof(b));
+
+  CHECK(wire_a[0] == 0x12 && wire_a[1] == 0x34);
+  CHECK(wire_b[0] == 0x12 && wire_b[1] == 0x34 && wire_b[2] == 0x56 && wire_b[3] == 0x78);
+
+  // Headers overlaid on a frame read the fields in host byte order
+  const bytes f = udp_frame(c_peer, c_local, pattern(5, 1));
+
+  const auto *eth = reinterpret_cast<const ipv4::eth_packet_header*>(f.data());
+  const auto *ip  = reinterpret_cast<const ipv4::ip_packet*>(f.data() + 14);
+  const auto *udp = reinterpret_cast<const ipv4::udp_packet*>(f.data() + 34);
+
+  CHECK(eth->type == ipv4::c_ether_type_ipv4 && eth->type.value() == 0x0800);
+  CHECK(ip->total_length.value() == 33 && ip->identification.value() == 1);
+  CHECK(udp->src_port.value() == 8001 && udp->dest_port.value() == 8000);
+  CHECK(udp->length.value() == 13);
+
+  const bytes r   = arp_frame(2, c_peer, c_local, c_local.hw_addr);
+  const auto  *arp = reinterpret_cast<const ipv4::arp_packet*>(r.data() + 14);
+
+  CHECK(arp->htype == ipv4::c_arp_htype_ethernet && arp->ptype == ipv4::c_ether_type_ipv4);
+  CHECK(arp->opcode == ipv4::c_arp_opcode_reply);
+}
+
+} // namespace unit
@@ -0,0 +1,170 @@
+/// \file fragmentation.cpp
+/// Datagrams larger than a frame are sent in IP fragments
+
+#include <algorithm>
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct fragmenting_config : ipv4::default_config
+{
+  static constexpr std::size_t interface_table_size     = 1;
+  static constexpr std::size_t frame_pool_size          = 131072U;
+  static constexpr std::size_t buffer_descriptor_size   = 16;
+  static constexpr std::size_t tx_queue_size            = 64;
+  static constexpr std::size_t reassembly_table_size    = 2;
+  static constexpr std::size_t reassembly_max_size      = 65515U;
+};
+
+/// The frames carry a datagram of size bytes in fragments which follow
+/// each other. Only a datagram sent whole is marked don't fragment
+bool
+is_fragmented
+(
+  const std::vector<bytes>& frames,
+  const std::size_t         size,
+  const bool                f_ip_checksum
+)
+{
+  std::size_t offset  = 0;
+  bool        result  = !frames.empty();
+
+  for (std::size_t k = 0; result && k < frames.size(); k++)
+  {
+    const bytes     &f    = frames[k];
+    const uint16_t  flags = field(f, 20);
+    const bool      f_mf  = (k + 1 < frames.size());
+
+    result =
+      (f.size() <= 1514) &&
+      ((flags & 0x1FFF) * 8U == offset) &&
+      (((flags & 0x2000) != 0) == f_mf) &&
+      (((flags & 0x4000) != 0) == (frames.size() == 1)) &&
+      (!f_ip_checksum || reference_checksum(&f[14], 20) == 0) &&
+      (field(f, 18) == field(frames[0], 18));
+
+    offset += field(f, 16) - 20U;
+  }
+
+  return result && (offset == 8 + size);
+}
+
+} // namespace
+
+void
+test_fragmentation()
+{
+  auto  a = std::make_unique<ipv4::stack<fragmenting_config>>();
+  auto  b = std::make_unique<ipv4::stack<fragmenting_config>>();
+  wire  wa(*a);
+  wire  wb(*b);
+
+  a->set(0, c_peer.hw_addr, c_peer.ip_addr);
+  b->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(wa, 0, c_local, c_peer);
+
+  auto ea = a->bind(0, 8001);
+  auto eb = b->bind(0, 8000);
+
+  // Datagrams are sent whole or in fragments, through send with a remote,
+  // with the UDP checksum offloaded and through a connected port, and
+  // are reassembled by the receiver
+  for (int mode = 0; mode < 3; mode++)
+  {
+    ipv4::offload_flags_t offload;
+
+    if (mode == 1)
+    {
+      offload.set<ipv4::offload_tx_l4>();
+    }
+    else if (mode == 2)
+    {
+      a->connect(ea, { c_local.ip_addr, 8000 });
+    }
+
+    a->configure(0, offload);
+
+    for (std::size_t size : { 100, 1472, 1473, 2960, 8192, 65507 })
+    {
+      const bytes       p     = pattern(size, uint8_t(size + mode));
+      const std::size_t sent  =
+        (mode == 2) ?
+        a->send(ea, p.data(), size) :
+        a->send(ea, p.data(), size, { c_local.ip_addr, 8000 });
+
+      wa.writes = 0;
+      wa.step();
+
+      CHECK(sent == size);
+      CHECK(wa.writes == 1);
+      CHECK(wa.tx[0].size() == (size + 8 + 1479) / 1480);
+      CHECK(is_fragmented(wa.tx[0], size, true));
+
+      for (auto &f : wa.tx[0])
+      {
+        f.resize(std::max<std::size_t>(f.size(), 60));
+        wb.rx[0].push_back(f);
+      }
+
+      wa.tx[0].clear();
+
+      while (!wb.rx[0].empty())
+      {
+        wb.step();
+      }
+
+      auto lease = b->receive_view(eb);
+
+      CHECK(lease.size == size && std::equal(p.begin(), p.end(), lease.data));
+      b->release(lease);
+    }
+  }
+
+  CHECK(b->interfaces()[0].statistics.udp_checksum_errors == 0);
+  CHECK(a->pool().statistics().used == 0 && b->pool().statistics().used == 0);
+
+  // The IP header checksum of each fragment is left to the MAC
+  ipv4::offload_flags_t tx_ip;
+
+  tx_ip.set<ipv4::offload_tx_ip>();
+  a->configure(0, tx_ip);
+  a->send(ea, pattern(3000, 1).data(), 3000);
+  wa.step();
+
+  CHECK(is_fragmented(wa.tx[0], 3000, false));
+
+  for (auto &f : wa.tx[0])
+  {
+    CHECK(field(f, 24) == 0);
+  }
+
+  // UDP datagrams are limited by the IP length, a lease to a single frame
+  std::vector<uint8_t> large(65508);
+
+  CHECK(a->send(ea, large.data(), large.size(), { c_local.ip_addr, 8000 }) == 0);
+  CHECK(!a->acquire_tx(ea, 1473));
+  CHECK(bool(a->acquire_tx(ea, 1472)));
+
+  // The default configuration fragments within its frame pool, the 
+  // largest datagram is given in config.hpp
+  auto  d = std::make_unique<ipv4::stack<>>();
+  wire  wd(*d);
+
+  d->set(0, c_peer.hw_addr, c_peer.ip_addr);
+  resolve(wd, 0, c_local, c_peer);
+
+  auto ed = d->bind(0, 8001);
+
+  CHECK(d->send(ed, large.data(), 7977, { c_local.ip_addr, 8000 }) == 0);
+  CHECK(d->send(ed, large.data(), 7976, { c_local.ip_addr, 8000 }) == 7976);
+  wd.step();
+  CHECK(wd.tx[0].size() == 6 && is_fragmented(wd.tx[0], 7976, true));
+}
+
+} // namespace unit
@@ -0,0 +1,148 @@
+/// \file frame_pool.cpp
+/// One frame pool shared by all interfaces, received datagrams stay in
+/// the block they are read into
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct jumbo_config : ipv4::default_config
+{
+  static constexpr std::size_t max_mtu                  = 9000;
+};
+
+/// Reads the frames of each interface from memory of the driver
+template<typename Stack>
+void
+step_in_place
+(
+  Stack&              s,
+  std::vector<bytes>& ring
+)
+{
+  std::size_t next = 0;
+
+  s.step
+  (
+    [&](ipv4::interface_designator id) -> bool
+    {
+      return (id == 0) && (next < ring.size());
+    },
+    [&](ipv4::interface_designator, ipv4::frame *frames, const std::size_t count) -> std::size_t
+    {
+      std::size_t n = 0;
+
+      for (; n < count && next < ring.size(); n++, next++)
+      {
+        frames[n].data      = ring[next].data();
+        frames[n].capacity  = ring[next].size();
+        frames[n].size      = ring[next].size();
+      }
+
+      return n;
+    },
+    [](ipv4::interface_designator, const ipv4::frame*, const std::size_t count) -> std::size_t
+    {
+      return count;
+    }
+  );
+}
+
+} // namespace
+
+// The pool holds a burst of frames of the largest MTU and one to send
+static_assert(ipv4::frame_pool_size<ipv4::default_config>() == ipv4::default_config::frame_pool_size, "default pool");
+static_assert(ipv4::frame_pool_size<jumbo_config>() >= (jumbo_config::rx_burst_size + 1) * 9014, "pool of jumbo frames");
+
+void
+test_frame_pool()
+{
+  auto        s     = std::make_unique<ipv4::stack<>>();
+  wire        w(*s);
+  auto        &pool = s->pool();
+  udp_options bad;
+
+  bad.bad_checksum = true;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  s->set(1, c_local_1.hw_addr, c_local_1.ip_addr);
+
+  auto ed = s->bind(ipv4::c_any_interface, 8000);
+
+  // Datagrams of both interfaces are left in their pool blocks, the one
+  // with a bad checksum is dropped with its block
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 1)));
+  w.rx[1].push_back(udp_frame(c_peer, c_local_1, pattern(1472, 2)));
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(20, 3), bad));
+  w.step();
+
+  CHECK(s->interfaces()[0].statistics.udp_checksum_errors == 1);
+  CHECK(pool.statistics().used > 1472);
+
+  for (uint8_t seed : { 1, 2 })
+  {
+    auto lease = s->receive_view(ed);
+
+    CHECK(pool.contains(lease.data));
+    CHECK(bytes(lease.data, lease.data + lease.size) == pattern(seed == 1 ? 10 : 1472, seed));
+    s->release(lease);
+  }
+
+  CHECK(pool.statistics().used == 0);
+
+  // Datagrams in memory of the driver are copied to the pool
+  std::vector<bytes> ring =
+  {
+    udp_frame(c_peer, c_local, pattern(30, 4)),
+    udp_frame(c_peer, c_local, pattern(30, 5), bad),
+  };
+
+  step_in_place(*s, ring);
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(pool.contains(lease.data));
+  CHECK(bytes(lease.data, lease.data + lease.size) == pattern(30, 4));
+  s->release(lease);
+  CHECK(s->received_length(ed) == 0 && s->interfaces()[0].statistics.udp_checksum_errors == 2);
+
+  // Transmitted datagrams and control frames are released once written
+  resolve(w, 0, c_peer, c_local);
+  s->send(ed, pattern(1000, 6).data(), 1000, { c_peer.ip_addr, 8001 });
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 7), 1));
+  w.step();
+
+  CHECK(w.tx[0].size() == 2);
+  CHECK(pool.statistics().used == 0 && pool.statistics().failures == 0);
+
+  // Datagrams held until their next hop is resolved may take the whole 
+  // pool, the ARP reply releasing them is still received
+  auto  h   = std::make_unique<ipv4::stack<>>();
+  wire  wh(*h);
+  auto  eh  = h->bind(0, 8000);
+
+  h->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  for (uint8_t k = 0; k < 4; k++)
+  {
+    CHECK(h->send(eh, pattern(1968, k).data(), 1968, { c_peer.ip_addr, 8001 }) == 1968);
+  }
+
+  wh.step();
+  CHECK(h->pool().statistics().used == h->pool().statistics().capacity);
+
+  wh.tx[0].clear();
+  wh.rx[0].push_back(arp_frame(2, c_peer, c_local, c_local.hw_addr));
+  wh.step();
+
+  CHECK(wh.tx[0].size() == 8);
+  CHECK(h->pool().statistics().used == 0);
+}
+
+} // namespace unit
@@ -0,0 +1,107 @@
+/// \file instances.cpp
+/// Stack instances share no state
+
+#include <memory>
+#include <thread>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+/// Receives count datagrams on a stack of its own, returns the number
+/// received intact
+std::size_t
+receive_datagrams
+(
+  const std::size_t count
+)
+{
+  auto        s       = std::make_unique<ipv4::stack<>>();
+  wire        w(*s);
+  std::size_t result  = 0;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto ed = s->bind(0, 8000);
+
+  for (std::size_t k = 0; k < count; k++)
+  {
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(100, uint8_t(k))));
+    w.step();
+
+    bytes           data(100);
+    ipv4::endpoint  remote;
+
+    if 
+    (
+      (s->receive(ed, data.data(), data.size(), remote) == 100) && 
+      (data == pattern(100, uint8_t(k)))
+    )
+    {
+      result++;
+    }
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_instances()
+{
+  auto  a = std::make_unique<ipv4::stack<>>();
+  auto  b = std::make_unique<ipv4::stack<>>();
+  wire  wa(*a);
+  wire  wb(*b);
+
+  a->set(0, c_local.hw_addr, c_local.ip_addr);
+  b->set(0, c_local_1.hw_addr, c_local_1.ip_addr);
+
+  auto ea = a->bind(0, 8000);
+  auto eb = b->bind(0, 8000);
+
+  CHECK(ea.has_value() && eb.has_value());
+
+  // Traffic of one instance is not seen by the other
+  wa.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 1)));
+  wa.step();
+  wa.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  wa.step();
+  wb.step();
+
+  CHECK(a->received_length(ea) == 10);
+  CHECK(b->received_length(eb) == 0);
+  CHECK(bool(ipv4::find_arp_entry(a->interfaces()[0], c_peer.ip_addr)));
+  CHECK(!ipv4::find_arp_entry(b->interfaces()[0], c_peer.ip_addr));
+  CHECK(wa.tx[0].size() == 1 && wb.tx[0].empty());
+
+  // Initializing one instance leaves the other bound
+  b->initialize();
+  CHECK(a->received_length(ea) == 10);
+
+  // Instances run on their own threads
+  std::size_t n0 = 0;
+  std::size_t n1 = 0;
+  std::thread t0([&n0] { n0 = receive_datagrams(500); });
+  std::thread t1([&n1] { n1 = receive_datagrams(500); });
+
+  t0.join();
+  t1.join();
+
+  CHECK(n0 == 500 && n1 == 500);
+
+  // The free functions use the default instance
+  ipv4::initialize();
+  CHECK(ipv4::set(0, c_local.hw_addr, c_local.ip_addr));
+  CHECK(ipv4::g_stack.interfaces()[0].ip_addr == c_local.ip_addr);
+
+  CHECK(ipv4::udp::bind(0, 8000).has_value());
+  ipv4::initialize();
+}
+
+} // namespace unit
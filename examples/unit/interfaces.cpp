@@ -0,0 +1,101 @@
+/// \file interfaces.cpp
+/// Frames are dispatched to the interface they are received on
+
+#include <algorithm>
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_interfaces()
+{
+  auto            s = std::make_unique<ipv4::stack<>>();
+  wire            w(*s);
+  uint8_t         buffer[64];
+  ipv4::endpoint  remote;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr, {255, 255, 255, 0});
+  s->set(1, c_local_1.hw_addr, c_local_1.ip_addr, {255, 255, 255, 0});
+
+  const host peer_1 = { c_peer.hw_addr, {10, 0, 1, 1} };
+
+  // A port bound to an interface receives only on that interface
+  auto ed = s->bind(1, 8000);
+
+  CHECK(ed.has_value());
+
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 1)));
+  w.rx[1].push_back(udp_frame(peer_1, c_local_1, pattern(10, 2)));
+  w.step();
+
+  CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 10 && buffer[0] == 2);
+  CHECK(s->received_length(ed) == 0);
+
+  // The addresses of the receiving interface are matched, not those of
+  // the first interface
+  w.rx[1].push_back(udp_frame(peer_1, { c_local_1.hw_addr, c_local.ip_addr }, pattern(10, 3)));
+  w.step();
+  w.rx[1].push_back(udp_frame(peer_1, { c_local.hw_addr, c_local_1.ip_addr }, pattern(10, 4)));
+  w.step();
+  CHECK(s->received_length(ed) == 0);
+
+  // A port bound to all interfaces receives on each, a port bound to the
+  // receiving interface takes precedence
+  auto any  = s->bind(ipv4::c_any_interface, 9000);
+  auto own  = s->bind(0, 9000);
+
+  CHECK(any.has_value() && own.has_value());
+
+  udp_options o;
+
+  o.dest_port = 9000;
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 5), o));
+  w.rx[1].push_back(udp_frame(peer_1, c_local_1, pattern(10, 6), o));
+  w.step();
+
+  CHECK(s->receive(own, buffer, sizeof(buffer), remote) == 10 && buffer[0] == 5);
+  CHECK(s->receive(any, buffer, sizeof(buffer), remote) == 10 && buffer[0] == 6);
+
+  // ARP state is kept per interface, the reply is written on the
+  // interface of the request
+  w.rx[1].push_back(arp_frame(1, peer_1, c_local_1, c_broadcast));
+  w.step();
+
+  CHECK(w.tx[0].empty());
+  CHECK(w.tx[1].size() == 1 && field(w.tx[1][0], 20) == 2);
+  CHECK(bool(ipv4::find_arp_entry(s->interfaces()[1], peer_1.ip_addr)));
+  CHECK(!ipv4::find_arp_entry(s->interfaces()[0], peer_1.ip_addr));
+
+  // Every interface is serviced in a single step
+  w.tx[1].clear();
+  w.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  w.rx[1].push_back(arp_frame(1, peer_1, c_local_1, c_broadcast));
+  w.step();
+  CHECK(w.tx[0].size() == 1 && w.tx[1].size() == 1);
+
+  // A port bound to all interfaces sends to a destination not resolved
+  // yet over the interface on whose subnet it is, otherwise over the
+  // first interface. The ARP request is written on that interface
+  const ipv4::address on_1  = {10, 0, 1, 7};
+  const ipv4::address off   = {192, 168, 0, 7};
+
+  w.tx[0].clear();
+  w.tx[1].clear();
+  CHECK(s->send(any, buffer, 10, { on_1, 8001 }) == 10);
+  w.step();
+  CHECK(w.tx[0].empty());
+  CHECK(w.tx[1].size() == 1 && field(w.tx[1][0], 20) == 1);
+  CHECK(std::equal(on_1.begin(), on_1.end(), &w.tx[1][0][38]));
+
+  w.tx[1].clear();
+  CHECK(s->send(any, buffer, 10, { off, 8001 }) == 10);
+  w.step();
+  CHECK(w.tx[1].empty());
+  CHECK(w.tx[0].size() == 1 && field(w.tx[0][0], 20) == 1);
+  CHECK(std::equal(off.begin(), off.end(), &w.tx[0][0][38]));
+}
+
+} // namespace unit
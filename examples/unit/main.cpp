@@ -0,0 +1,42 @@
+// Example compile statement
+// g++ -Wall -Wextra -g -I../../../haluj/include -I../../../bit/include -I../../include -std=c++17 -pthread -o unit *.cpp ../../src/protocol/ipv4/stack.cpp
+//
+// Checks of the IPV4 stack. Failed checks are reported with their place,
+// and the program fails if any check fails.
+
+#include <iostream>
+
+#include "unit.hpp"
+
+int main()
+{
+  unit::test_interfaces();
+  unit::test_instances();
+  unit::test_arp_cache();
+  unit::test_arp_resolution();
+  unit::test_port_demux();
+  unit::test_rx_lease();
+  unit::test_tx_lease();
+  unit::test_allocator();
+  unit::test_burst();
+  unit::test_tx_queue();
+  unit::test_checksum();
+  unit::test_checksum_copy();
+  unit::test_echo();
+  unit::test_offload();
+  unit::test_connected();
+  unit::test_parse();
+  unit::test_read_only();
+  unit::test_endian();
+  unit::test_config();
+  unit::test_descriptors();
+  unit::test_reassembly();
+  unit::test_fragmentation();
+  unit::test_mtu();
+  unit::test_frame_pool();
+  unit::test_deliver();
+
+  std::cout << unit::failures() << " check(s) failed\n";
+
+  return (unit::failures() == 0) ? 0 : 1;
+}
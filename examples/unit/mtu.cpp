@@ -0,0 +1,141 @@
+/// \file mtu.cpp
+/// The MTU of each interface is set at run time, up to max_mtu
+
+#include <algorithm>
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct jumbo_config : ipv4::default_config
+{
+  static constexpr std::size_t interface_table_size     = 1;
+  static constexpr std::size_t max_mtu                  = 9000;
+  static constexpr std::size_t frame_pool_size          = 131072U;
+  static constexpr std::size_t buffer_descriptor_size   = 16;
+  static constexpr std::size_t tx_queue_size            = 64;
+  static constexpr std::size_t reassembly_table_size    = 2;
+  static constexpr std::size_t reassembly_max_size      = 65515U;
+};
+
+struct exchange
+{
+  std::size_t frames;
+  std::size_t largest;
+  bool        f_delivered;
+};
+
+/// Sends a datagram of size bytes from a to b and reads it at b
+template<typename Stack>
+exchange
+send
+(
+  wire<Stack>&                      wa,
+  wire<Stack>&                      wb,
+  const ipv4::endpoint_designator&  ea,
+  const ipv4::endpoint_designator&  eb,
+  const std::size_t                 size
+)
+{
+  const bytes p       = pattern(size, uint8_t(size));
+  exchange    result  = { 0, 0, false };
+
+  if (wa.stack.send(ea, p.data(), size, { c_local.ip_addr, 8000 }) == size)
+  {
+    wa.step();
+
+    for (auto &f : wa.tx[0])
+    {
+      result.largest = std::max(result.largest, f.size());
+      f.resize(std::max<std::size_t>(f.size(), 60));
+      wb.rx[0].push_back(f);
+    }
+
+    result.frames = wa.tx[0].size();
+    wa.tx[0].clear();
+
+    while (!wb.rx[0].empty())
+    {
+      wb.step();
+    }
+
+    auto lease = wb.stack.receive_view(eb);
+
+    result.f_delivered = (lease.size == size) && std::equal(p.begin(), p.end(), lease.data);
+    wb.stack.release(lease);
+  }
+
+  return result;
+}
+
+} // namespace
+
+void
+test_mtu()
+{
+  auto  a = std::make_unique<ipv4::stack<jumbo_config>>();
+  auto  b = std::make_unique<ipv4::stack<jumbo_config>>();
+  wire  wa(*a);
+  wire  wb(*b);
+
+  a->set(0, c_peer.hw_addr, c_peer.ip_addr);
+  b->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(wa, 0, c_local, c_peer);
+
+  auto ea = a->bind(0, 8001);
+  auto eb = b->bind(0, 8000);
+
+  // Interfaces start at max_mtu, jumbo frames carry the datagrams
+  exchange e = send(wa, wb, ea, eb, 8972);
+
+  CHECK(e.frames == 1 && e.largest == 9014 && e.f_delivered);
+
+  e = send(wa, wb, ea, eb, 8973);
+  CHECK(e.frames == 2 && e.largest <= 9014 && e.f_delivered);
+
+  e = send(wa, wb, ea, eb, 30000);
+  CHECK(e.frames == 4 && e.f_delivered);
+
+  // The MTU is limited to max_mtu and to the minimum of IPV4
+  CHECK(!a->set_mtu(0, 67));
+  CHECK(!a->set_mtu(0, 9001));
+  CHECK(!a->set_mtu(1, 1500));
+  CHECK(a->set_mtu(0, 1500));
+
+  e = send(wa, wb, ea, eb, 1472);
+  CHECK(e.frames == 1 && e.largest == 1514 && e.f_delivered);
+
+  e = send(wa, wb, ea, eb, 1473);
+  CHECK(e.frames == 2 && e.largest == 1514 && e.f_delivered);
+
+  e = send(wa, wb, ea, eb, 8972);
+  CHECK(e.frames == 7 && e.largest == 1514 && e.f_delivered);
+
+  // A lease is limited to one frame. Committed without a remote it is
+  // discarded
+  auto lease = a->acquire_tx(ea, 1472);
+
+  CHECK(bool(lease) && !a->acquire_tx(ea, 1473));
+  a->commit_tx(lease);
+
+  // Frames are read into buffers of the MTU of the receiving interface,
+  // a jumbo frame does not fit one of 1500 bytes
+  a->set_mtu(0, 9000);
+  b->set_mtu(0, 1500);
+
+  e = send(wa, wb, ea, eb, 3000);
+  CHECK(e.frames == 1 && e.largest == 3042 && !e.f_delivered);
+
+  b->set_mtu(0, 9000);
+
+  e = send(wa, wb, ea, eb, 3000);
+  CHECK(e.frames == 1 && e.f_delivered);
+  CHECK(a->pool().statistics().used == 0 && b->pool().statistics().used == 0);
+}
+
+} // namespace unit
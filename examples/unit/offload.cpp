@@ -0,0 +1,138 @@
+/// \file offload.cpp
+/// Checksums offloaded to the MAC are left to it
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct verifying_config : ipv4::default_config
+{
+  static constexpr bool        icmp_checksum_enabled    = true;
+};
+
+} // namespace
+
+void
+test_offload()
+{
+  auto  s   = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+  auto  &st = s->interfaces()[0].statistics;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto ed = s->bind(0, 8000);
+
+  // The checksums offloaded on transmission are left zero, the others
+  // are formed
+  ipv4::offload_flags_t tx_ip;
+  ipv4::offload_flags_t tx_l4;
+
+  tx_ip.set<ipv4::offload_tx_ip>();
+  tx_l4.set<ipv4::offload_tx_l4>();
+
+  CHECK(s->configure(0, tx_ip));
+  CHECK(!s->configure(ipv4::default_config::interface_table_size, tx_ip));
+
+  s->send(ed, pattern(100, 1).data(), 100, { c_peer.ip_addr, 8001 });
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 2), 1));
+  w.step();
+
+  CHECK(w.tx[0].size() == 2);
+
+  for (auto &f : w.tx[0])
+  {
+    CHECK(field(f, 24) == 0);
+  }
+
+  // The echo reply is formed on reception, before the datagram
+  if (w.tx[0].size() == 2)
+  {
+    CHECK(w.tx[0][0][23] == 1 && reference_checksum(&w.tx[0][0][34], 40) == 0);
+    CHECK(w.tx[0][1][23] == 17 && field(w.tx[0][1], 40) != 0);
+  }
+
+  w.tx[0].clear();
+  s->configure(0, tx_l4);
+
+  s->send(ed, pattern(100, 1).data(), 100, { c_peer.ip_addr, 8001 });
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 2), 1));
+  w.step();
+
+  CHECK(w.tx[0].size() == 2);
+
+  if (w.tx[0].size() == 2)
+  {
+    CHECK(is_valid_ip_frame(w.tx[0][0]) && is_valid_ip_frame(w.tx[0][1]));
+    CHECK(w.tx[0][0][23] == 1 && field(w.tx[0][0], 36) == 0);
+    CHECK(w.tx[0][1][23] == 17 && field(w.tx[0][1], 40) == 0);
+    CHECK(udp_payload(w.tx[0][1]) == pattern(100, 1));
+  }
+
+  // The checksums of a received frame are skipped only if the MAC
+  // verifies them and flags the frame
+  ipv4::offload_flags_t rx;
+  udp_options           bad;
+
+  rx.set<ipv4::offload_rx>();
+  bad.bad_checksum = true;
+
+  bytes bad_ip = udp_frame(c_peer, c_local, pattern(10, 3));
+
+  bad_ip[24] ^= 0x01;
+
+  s->configure(0, ipv4::offload_flags_t());
+  w.rx_flags.set<ipv4::checksum_verified>();
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 4), bad));
+  w.rx[0].push_back(bad_ip);
+  w.step();
+
+  CHECK(s->received_length(ed) == 0);
+  CHECK(st.udp_checksum_errors == 1 && st.ip_checksum_errors == 1);
+
+  s->configure(0, rx);
+  w.rx_flags = ipv4::frame_flags_t();
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 5), bad));
+  w.step();
+
+  CHECK(s->received_length(ed) == 0);
+  CHECK(st.udp_checksum_errors == 2);
+
+  w.rx_flags.set<ipv4::checksum_verified>();
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 6), bad));
+  w.rx[0].push_back(bad_ip);
+  w.step();
+
+  CHECK(st.udp_checksum_errors == 2 && st.ip_checksum_errors == 1);
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(lease.size == 10 && lease.data[0] == 6);
+  s->release(lease);
+  CHECK(s->received_length(ed) == 10);
+
+  // ICMP checksums verified by the MAC are not summed again
+  auto  v   = std::make_unique<ipv4::stack<verifying_config>>();
+  wire  vw(*v);
+  bytes corrupted = icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1);
+
+  corrupted[50] ^= 0x10;
+
+  v->set(0, c_local.hw_addr, c_local.ip_addr);
+  v->configure(0, rx);
+  vw.rx_flags.set<ipv4::checksum_verified>();
+  vw.rx[0].push_back(corrupted);
+  vw.step();
+
+  CHECK(vw.tx[0].size() == 1);
+  CHECK(v->interfaces()[0].statistics.icmp_checksum_errors == 0);
+}
+
+} // namespace unit
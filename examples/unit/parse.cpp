@@ -0,0 +1,164 @@
+/// \file parse.cpp
+/// Received frames are validated and parsed in a single pass
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+/// Parses the first size bytes of the frame
+bool
+parses
+(
+  bytes                   f,
+  ipv4::packet_metadata&  m,
+  const std::size_t       size
+)
+{
+  ipv4::frame fr;
+
+  fr.data     = f.data();
+  fr.capacity = f.size();
+  fr.size     = size;
+
+  return ipv4::parse_frame(fr, 1514, m);
+}
+
+bool
+parses
+(
+  const bytes&  f
+)
+{
+  ipv4::packet_metadata m;
+
+  return parses(f, m, f.size());
+}
+
+void
+set_field
+(
+  bytes&            f,
+  const std::size_t offset,
+  const uint16_t    value
+)
+{
+  f[offset]     = uint8_t(value >> 8);
+  f[offset + 1] = uint8_t(value);
+}
+
+} // namespace
+
+void
+test_parse()
+{
+  // A padded datagram is parsed up to its payload, the padding is not
+  // part of it
+  const bytes           udp   = udp_frame(c_peer, c_local, pattern(5, 1));
+  const bytes           echo  = icmp_echo_frame(c_peer, c_local, pattern(32, 1), 1);
+  const bytes           arp   = arp_frame(1, c_peer, c_local, c_broadcast);
+  ipv4::packet_metadata m;
+
+  CHECK(udp.size() == 60);
+  CHECK(parses(udp, m, udp.size()));
+  CHECK(m.ether_type == ipv4::c_ether_type_ipv4 && m.ip_protocol == 17);
+  CHECK(m.l3_offset == 14 && m.l4_offset == 34);
+  CHECK(m.payload_offset == 42 && m.payload_size == 5 && !m.is_fragment);
+
+  CHECK(parses(echo, m, echo.size()));
+  CHECK(m.ip_protocol == 1 && m.payload_offset == 42 && m.payload_size == 32);
+
+  CHECK(parses(arp, m, arp.size()));
+  CHECK(m.ether_type == ipv4::c_ether_type_arp);
+
+  // Frames shorter than the minimum, or longer than the maximum, are
+  // rejected
+  CHECK(!parses(udp, m, 59));
+  CHECK(!parses(udp_frame(c_peer, c_local, pattern(1473, 1))));
+
+  // Unsupported ether types and IP headers are rejected
+  bytes f = udp;
+
+  set_field(f, 12, 0x86DD);
+  CHECK(!parses(f));
+
+  f     = udp;
+  f[14] = 0x46;
+  CHECK(!parses(f));
+
+  f     = udp;
+  f[15] = 0x10;
+  CHECK(!parses(f));
+
+  f     = udp;
+  f[20] |= 0x80;
+  CHECK(!parses(f));
+
+  // The IP length is within the frame, the UDP length is the one of the
+  // IP payload
+  f = udp;
+  set_field(f, 16, 47);
+  CHECK(!parses(f));
+
+  f = udp;
+  set_field(f, 16, 19);
+  CHECK(!parses(f));
+
+  f = udp;
+  set_field(f, 38, 14);
+  CHECK(!parses(f));
+
+  f = udp;
+  set_field(f, 38, 12);
+  CHECK(!parses(f));
+
+  f = udp;
+  set_field(f, 16, 27);
+  set_field(f, 38, 7);
+  CHECK(!parses(f));
+
+  // An ICMP message carries at least its header
+  f = echo;
+  set_field(f, 16, 27);
+  CHECK(!parses(f));
+
+  // Fragments but the last carry multiples of 8 bytes
+  f = udp_frame(c_peer, c_local, pattern(8, 1));
+  set_field(f, 20, 0x2000);
+  CHECK(parses(f, m, f.size()));
+  CHECK(m.is_fragment && m.more_fragments && m.payload_size == 16);
+
+  set_field(f, 16, 20 + 12);
+  CHECK(!parses(f));
+
+  // The stack drops malformed frames without answering them, and still
+  // receives the valid ones after them
+  auto  s = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto ed = s->bind(0, 8000);
+
+  f = echo;
+  set_field(f, 16, 27);
+  w.rx[0].push_back(f);
+
+  f = udp;
+  set_field(f, 38, 14);
+  w.rx[0].push_back(f);
+  w.rx[0].push_back(bytes(udp.begin(), udp.begin() + 40));
+  w.rx[0].push_back(udp);
+  w.step();
+
+  CHECK(w.tx[0].empty());
+  CHECK(s->received_length(ed) == 5);
+}
+
+} // namespace unit
@@ -0,0 +1,206 @@
+/// \file port_demux.cpp
+/// Demultiplexing of UDP ports, binding and unbinding
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct many_ports_config : ipv4::default_config
+{
+  static constexpr std::size_t udp_ports_table_size     = 64;
+};
+
+/// 32 bit pseudo random sequence, the same on every run
+uint32_t
+next_random
+(
+  uint32_t& state
+)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+
+  return state;
+}
+
+} // namespace
+
+void
+test_port_demux()
+{
+  {
+    // Random insertions and removals agree with a map. Ports are drawn
+    // from a small range so the probe sequences collide and removals
+    // shift entries back
+    typedef ipv4::port_demux<16>  demux_type;
+    typedef std::pair<std::size_t, uint16_t>  key;
+
+    demux_type                      demux;
+    std::map<key, std::size_t>      model;
+    uint32_t                        state     = 2463534242U;
+    bool                            f_agrees  = true;
+
+    for (std::size_t n = 0; n < 20000; n++)
+    {
+      const std::size_t id    = (next_random(state) % 3 == 0) ? demux_type::c_any : next_random(state) % 2;
+      const uint16_t    port  = uint16_t(8000 + next_random(state) % 24);
+      const key         k(id, port);
+
+      if (next_random(state) % 2 == 0 && model.size() < 16)
+      {
+        const bool f_inserted = demux.insert(id, port, n % 16);
+
+        f_agrees = f_agrees && (f_inserted == (model.count(k) == 0));
+
+        if (f_inserted)
+        {
+          model[k] = n % 16;
+        }
+      }
+      else
+      {
+        demux.remove(id, port);
+        model.erase(k);
+      }
+
+      for (uint16_t p = 8000; p < 8024; p++)
+      {
+        for (std::size_t i : { std::size_t(0), std::size_t(1), demux_type::c_any })
+        {
+          auto found = demux.find_exact(i, p);
+          auto it    = model.find(key(i, p));
+
+          f_agrees = f_agrees && (found.has_value() == (it != model.end()));
+          f_agrees = f_agrees && (!found || *found == it->second);
+        }
+      }
+    }
+
+    CHECK(f_agrees);
+
+    // A port bound to the interface is found before the same port bound
+    // to all interfaces
+    demux.clear();
+    demux.insert(demux_type::c_any, 9000, 1);
+    demux.insert(0, 9000, 2);
+
+    CHECK(demux.find(0, 9000) == std::optional<std::size_t>(2));
+    CHECK(demux.find(1, 9000) == std::optional<std::size_t>(1));
+    demux.remove(0, 9000);
+    CHECK(demux.find(0, 9000) == std::optional<std::size_t>(1));
+  }
+
+  {
+    auto  s = std::make_unique<ipv4::stack<many_ports_config>>();
+    wire  w(*s);
+
+    s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+    // Every slot of the port table can be bound
+    std::vector<ipv4::endpoint_designator> eds;
+
+    for (uint16_t p = 0; p < 64; p++)
+    {
+      eds.push_back(s->bind(0, uint16_t(7000 + p)));
+      CHECK(eds.back().has_value());
+    }
+
+    CHECK(!s->bind(0, 8000).has_value());
+
+    udp_options o;
+
+    o.dest_port = 7063;
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 1), o));
+    w.step();
+    CHECK(s->received_length(eds[63]) == 10);
+
+    // Unbinding discards the datagrams queued, and frees the slot and the
+    // port for binding again
+    const std::size_t used = s->pool().statistics().used;
+
+    CHECK(s->unbind(eds[63]));
+    CHECK(!s->unbind(eds[63]));
+    CHECK(s->received_length(eds[63]) == 0);
+    CHECK(s->pool().statistics().used < used);
+
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 2), o));
+    w.step();
+
+    auto ed = s->bind(0, 7063);
+
+    CHECK(ed.has_value());
+    CHECK(s->received_length(ed) == 0);
+
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 3), o));
+    w.step();
+
+    auto lease = s->receive_view(ed);
+
+    CHECK(lease.size == 10 && lease.data[0] == 3);
+    s->release(lease);
+
+    // Ports unbound in the middle of the probe sequences leave the others
+    // reachable
+    for (uint16_t p = 0; p < 63; p += 2)
+    {
+      CHECK(s->unbind(eds[p]));
+    }
+
+    bool f_received = true;
+
+    for (uint16_t p = 1; p < 63; p += 2)
+    {
+      o.dest_port = uint16_t(7000 + p);
+      w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, uint8_t(p)), o));
+      w.step();
+
+      lease = s->receive_view(eds[p]);
+      f_received = f_received && (lease.size == 10) && (lease.data[0] == uint8_t(p));
+      s->release(lease);
+    }
+
+    CHECK(f_received);
+  }
+
+  {
+    // Initializing the stack discards the datagrams queued, a port bound
+    // again receives only the datagrams arriving after
+    auto        s = std::make_unique<ipv4::stack<>>();
+    wire        w(*s);
+    udp_options o;
+
+    s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+    auto ed = s->bind(0, 8000);
+
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 1), o));
+    w.step();
+    CHECK(s->received_length(ed) == 10);
+
+    s->initialize();
+    ed = s->bind(0, 8000);
+
+    CHECK(ed.has_value());
+    CHECK(s->received_length(ed) == 0);
+
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(20, 2), o));
+    w.step();
+
+    uint8_t         buffer[64];
+    ipv4::endpoint  remote;
+
+    CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 20 && buffer[0] == 2);
+    CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 0);
+  }
+}
+
+} // namespace unit
@@ -0,0 +1,89 @@
+/// \file read_only.cpp
+/// Received frames in memory of the driver are only read
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_read_only()
+{
+  auto  s = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto ed = s->bind(0, 8000);
+
+  // The frames are handed to the stack where the driver holds them, as
+  // from a DMA ring, and are the same once step() returns
+  udp_options bad;
+
+  bad.bad_checksum = true;
+
+  std::vector<bytes> ring =
+  {
+    arp_frame(1, c_peer, c_local, c_broadcast),
+    icmp_echo_frame(c_peer, c_local, pattern(33, 1), 1),
+    udp_frame(c_peer, c_local, pattern(101, 2)),
+    udp_frame(c_peer, c_local, pattern(101, 3), bad),
+  };
+
+  const std::vector<bytes>  received  = ring;
+  std::size_t               next      = 0;
+
+  s->step
+  (
+    [&](ipv4::interface_designator id) -> bool
+    {
+      return (id == 0) && (next < ring.size());
+    },
+    [&](ipv4::interface_designator, ipv4::frame *frames, const std::size_t count) -> std::size_t
+    {
+      std::size_t n = 0;
+
+      for (; n < count && next < ring.size(); n++, next++)
+      {
+        frames[n].data      = ring[next].data();
+        frames[n].capacity  = ring[next].size();
+        frames[n].size      = ring[next].size();
+      }
+
+      return n;
+    },
+    [&](ipv4::interface_designator id, const ipv4::frame *frames, const std::size_t count) -> std::size_t
+    {
+      for (std::size_t k = 0; k < count; k++)
+      {
+        w.tx[id].push_back(bytes(frames[k].data, frames[k].data + frames[k].size));
+      }
+
+      return count;
+    }
+  );
+
+  CHECK(ring == received);
+
+  // The ARP request and the echo request are answered, the datagram is
+  // received and the one with a bad checksum dropped
+  CHECK(w.tx[0].size() == 2);
+
+  if (w.tx[0].size() == 2)
+  {
+    CHECK(field(w.tx[0][0], 12) == 0x0806 && field(w.tx[0][0], 20) == 2);
+    CHECK(w.tx[0][1][23] == 1 && w.tx[0][1][34] == 0);
+  }
+
+  CHECK(s->received_length(ed) == 101);
+  CHECK(s->interfaces()[0].statistics.udp_checksum_errors == 1);
+
+  auto lease = s->receive_view(ed);
+
+  CHECK(lease.size == 101 && bytes(lease.data, lease.data + lease.size) == pattern(101, 2));
+  s->release(lease);
+}
+
+} // namespace unit
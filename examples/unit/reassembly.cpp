@@ -0,0 +1,194 @@
+/// \file reassembly.cpp
+/// Fragmented datagrams are reassembled, or dropped with their state
+
+#include <algorithm>
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+struct reassembling_config : ipv4::default_config
+{
+  static constexpr std::size_t frame_pool_size          = 65536U;
+  static constexpr std::size_t buffer_descriptor_size   = 16;
+  static constexpr std::size_t reassembly_table_size    = 4;
+  static constexpr std::size_t reassembly_max_size      = 8200U;
+  static constexpr std::size_t reassembly_hole_limit    = 8;
+};
+
+udp_options
+datagram
+(
+  const uint16_t  identification
+)
+{
+  udp_options result;
+
+  result.identification = identification;
+
+  return result;
+}
+
+/// Steps until the frames are read
+template<typename Stack>
+void
+feed
+(
+  wire<Stack>&              w,
+  const std::vector<bytes>& frames
+)
+{
+  w.rx[0].insert(w.rx[0].end(), frames.begin(), frames.end());
+
+  while (!w.rx[0].empty())
+  {
+    w.step();
+  }
+}
+
+/// The next datagram of the port is the payload, from the peer
+template<typename Stack>
+bool
+receives
+(
+  Stack&                            s,
+  const ipv4::endpoint_designator&  ed,
+  const bytes&                      payload
+)
+{
+  auto lease  = s.receive_view(ed);
+  bool result =
+    (lease.size == payload.size()) &&
+    (lease.remote.port == 8001) &&
+    std::equal(payload.begin(), payload.end(), lease.data);
+
+  s.release(lease);
+
+  return result;
+}
+
+} // namespace
+
+void
+test_reassembly()
+{
+  auto  s     = std::make_unique<ipv4::stack<reassembling_config>>();
+  wire  w(*s);
+  auto  &st   = s->interfaces()[0].statistics;
+  auto  used  = [&s] { return s->pool().statistics().used; };
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto ed = s->bind(0, 8000);
+
+  // Fragments in order, reversed, and shuffled with a duplicate
+  feed(w, udp_fragments(c_peer, c_local, pattern(8192, 1), 1480, datagram(1)));
+  CHECK(receives(*s, ed, pattern(8192, 1)));
+  CHECK(used() == 0);
+
+  std::vector<bytes> f = udp_fragments(c_peer, c_local, pattern(5000, 2), 1480, datagram(2));
+
+  std::reverse(f.begin(), f.end());
+  feed(w, f);
+  CHECK(receives(*s, ed, pattern(5000, 2)));
+
+  f = udp_fragments(c_peer, c_local, pattern(4000, 3), 256, datagram(3));
+  std::swap(f[1], f[9]);
+  std::swap(f[3], f[12]);
+  f.insert(f.end() - 1, f[5]);
+  feed(w, f);
+  CHECK(receives(*s, ed, pattern(4000, 3)));
+
+  // Two datagrams interleaved are told apart by their identification
+  const std::vector<bytes> a = udp_fragments(c_peer, c_local, pattern(3000, 4), 1480, datagram(4));
+  const std::vector<bytes> b = udp_fragments(c_peer, c_local, pattern(3000, 5), 1480, datagram(5));
+
+  f.clear();
+
+  for (std::size_t k = 0; k < a.size(); k++)
+  {
+    f.push_back(a[k]);
+    f.push_back(b[k]);
+  }
+
+  feed(w, f);
+  CHECK(receives(*s, ed, pattern(3000, 4)));
+  CHECK(receives(*s, ed, pattern(3000, 5)));
+  CHECK(st.reassembly_drops == 0);
+
+  // The checksum is verified over the whole datagram
+  udp_options bad = datagram(6);
+
+  bad.bad_checksum = true;
+
+  feed(w, udp_fragments(c_peer, c_local, pattern(3000, 6), 1480, bad));
+  CHECK(s->received_length(ed) == 0);
+  CHECK(st.udp_checksum_errors == 1);
+
+  // A datagram larger than reassembly_max_size is dropped
+  feed(w, udp_fragments(c_peer, c_local, pattern(9000, 7), 1480, datagram(7)));
+  CHECK(s->received_length(ed) == 0);
+  CHECK(st.reassembly_drops > 0);
+  CHECK(s->interfaces()[0].reassemblies.size() == 0);
+
+  // An incomplete datagram holds the pool until it times out
+  f = udp_fragments(c_peer, c_local, pattern(3000, 8), 1480, datagram(8));
+  f.pop_back();
+  feed(w, f);
+  CHECK(s->interfaces()[0].reassemblies.size() == 1 && used() > 0);
+
+  for (std::size_t n = 0; n < reassembling_config::reassembly_timeout; n++)
+  {
+    w.step();
+  }
+
+  CHECK(st.reassembly_timeouts == 1);
+  CHECK(s->interfaces()[0].reassemblies.size() == 0 && used() == 0);
+
+  // Fragments overlapping the data received drop the datagram
+  const std::size_t drops = st.reassembly_drops;
+
+  feed
+  (
+    w,
+    {
+      udp_fragments(c_peer, c_local, pattern(3000, 9), 1480, datagram(9))[0],
+      udp_fragments(c_peer, c_local, pattern(3000, 9), 1024, datagram(9))[1]
+    }
+  );
+
+  CHECK(st.reassembly_drops == drops + 1);
+  CHECK(s->interfaces()[0].reassemblies.size() == 0);
+
+  // Datagrams which are not fragmented are received as before, and a
+  // reassembled one can be copied out
+  feed(w, { udp_frame(c_peer, c_local, pattern(100, 10)) });
+  CHECK(receives(*s, ed, pattern(100, 10)));
+  CHECK(used() == 0);
+
+  feed(w, udp_fragments(c_peer, c_local, pattern(2000, 11), 1480, datagram(11)));
+
+  uint8_t         buffer[3000];
+  ipv4::endpoint  remote;
+
+  CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 2000);
+  CHECK(bytes(buffer, buffer + 2000) == pattern(2000, 11));
+
+  // Without a reassembly table fragments are dropped
+  auto  d = std::make_unique<ipv4::stack<>>();
+  wire  dw(*d);
+
+  d->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto d_ed = d->bind(0, 8000);
+
+  feed(dw, udp_fragments(c_peer, c_local, pattern(1400, 12), 800, datagram(12)));
+  CHECK(d->received_length(d_ed) == 0);
+}
+
+} // namespace unit
@@ -0,0 +1,98 @@
+/// \file rx_lease.cpp
+/// Datagrams are read in place through receive leases
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_rx_lease()
+{
+  auto  s = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+
+  auto ed = s->bind(0, 8000);
+
+  // Nothing to receive gives an empty lease, releasing it does nothing
+  auto empty = s->receive_view(ed);
+
+  CHECK(!empty && empty.data == nullptr && empty.size == 0);
+  s->release(empty);
+
+  const std::size_t used = s->pool().statistics().used;
+
+  // The lease holds the payload and the remote of the datagram
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(300, 1)));
+  w.step();
+
+  auto first = s->receive_view(ed);
+
+  CHECK(first && bytes(first.data, first.data + first.size) == pattern(300, 1));
+  CHECK(first.remote.ip_addr == c_peer.ip_addr && first.remote.port == 8001);
+  CHECK(s->received_length(ed) == 0);
+
+  // The payload stays in place while more datagrams are received and
+  // read, the datagram is off the queue of the port
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(200, 2)));
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(100, 3)));
+  w.step();
+
+  CHECK(s->received_length(ed) == 200);
+
+  auto second = s->receive_view(ed);
+
+  uint8_t         buffer[100];
+  ipv4::endpoint  remote;
+
+  CHECK(s->receive(ed, buffer, sizeof(buffer), remote) == 100);
+  CHECK(bytes(buffer, buffer + 100) == pattern(100, 3));
+  CHECK(bytes(first.data, first.data + first.size) == pattern(300, 1));
+  CHECK(bytes(second.data, second.data + second.size) == pattern(200, 2));
+
+  // Releasing returns the buffers and empties the lease
+  s->release(first);
+  s->release(second);
+
+  CHECK(!first && first.data == nullptr && first.size == 0);
+  CHECK(s->pool().statistics().used == used);
+
+  // Leases held take receive descriptors, the datagrams arriving while
+  // none is free are dropped
+  std::vector<ipv4::rx_lease<>> leases;
+
+  for (uint8_t k = 0; k < 8; k++)
+  {
+    w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, k)));
+    w.step();
+
+    auto lease = s->receive_view(ed);
+
+    if (lease)
+    {
+      leases.push_back(lease);
+    }
+  }
+
+  CHECK(leases.size() == ipv4::default_config::buffer_descriptor_size);
+
+  for (auto &lease : leases)
+  {
+    s->release(lease);
+  }
+
+  w.rx[0].push_back(udp_frame(c_peer, c_local, pattern(10, 9)));
+  w.step();
+
+  auto last = s->receive_view(ed);
+
+  CHECK(last && last.data[0] == 9);
+  s->release(last);
+  CHECK(s->pool().statistics().used == used);
+}
+
+} // namespace unit
@@ -0,0 +1,121 @@
+/// \file tx_lease.cpp
+/// Datagrams are formed in place through transmit leases
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_tx_lease()
+{
+  auto  s = std::make_unique<ipv4::stack<>>();
+  wire  w(*s);
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto              ed    = s->bind(0, 8000);
+  const std::size_t used  = s->pool().statistics().used;
+
+  // The payload written through the lease is sent with the headers formed
+  // in front of it
+  auto lease = s->acquire_tx(ed, 300);
+
+  CHECK(lease && lease.size == 300);
+
+  if (lease)
+  {
+    const bytes p = pattern(300, 1);
+
+    std::memcpy(lease.data, p.data(), p.size());
+  }
+
+  CHECK(s->commit_tx(lease, { c_peer.ip_addr, 9000 }) == 300);
+  CHECK(!lease);
+
+  w.step();
+
+  CHECK(w.tx[0].size() == 1);
+
+  if (w.tx[0].size() == 1)
+  {
+    const bytes &f = w.tx[0][0];
+
+    CHECK(is_valid_udp_frame(f));
+    CHECK(bytes(f.begin(), f.begin() + 6) == bytes(c_peer.hw_addr.begin(), c_peer.hw_addr.end()));
+    CHECK(bytes(f.begin() + 6, f.begin() + 12) == bytes(c_local.hw_addr.begin(), c_local.hw_addr.end()));
+    CHECK(bytes(f.begin() + 30, f.begin() + 34) == bytes(c_peer.ip_addr.begin(), c_peer.ip_addr.end()));
+    CHECK(field(f, 34) == 8000 && field(f, 36) == 9000);
+    CHECK(udp_payload(f) == pattern(300, 1));
+  }
+
+  CHECK(s->pool().statistics().used == used);
+
+  // Leases are sent in the order committed, not acquired
+  w.tx[0].clear();
+
+  auto a = s->acquire_tx(ed, 10);
+  auto b = s->acquire_tx(ed, 20);
+
+  CHECK(a && b && a.data != b.data);
+
+  if (a && b)
+  {
+    std::memset(a.data, 0xAA, a.size);
+    std::memset(b.data, 0xBB, b.size);
+  }
+
+  s->commit_tx(b, { c_peer.ip_addr, 9000 });
+  w.step();
+  s->commit_tx(a, { c_peer.ip_addr, 9000 });
+  w.step();
+
+  CHECK(w.tx[0].size() == 2);
+
+  if (w.tx[0].size() == 2)
+  {
+    CHECK(udp_payload(w.tx[0][0]) == bytes(20, 0xBB));
+    CHECK(udp_payload(w.tx[0][1]) == bytes(10, 0xAA));
+  }
+
+  // A released lease is not sent and its buffer is returned
+  w.tx[0].clear();
+  lease = s->acquire_tx(ed, 100);
+  CHECK(bool(lease));
+  s->release(lease);
+  CHECK(!lease);
+  w.step();
+  CHECK(w.tx[0].empty());
+  CHECK(s->pool().statistics().used == used);
+
+  // The payload of a lease fits in a single frame
+  lease = s->acquire_tx(ed, 1472);
+  CHECK(bool(lease));
+  s->release(lease);
+  CHECK(!s->acquire_tx(ed, 1473));
+
+  // Leases take transmit descriptors until they are committed
+  std::vector<ipv4::tx_lease<>> leases;
+
+  for (std::size_t k = 0; k <= ipv4::default_config::buffer_descriptor_size; k++)
+  {
+    leases.push_back(s->acquire_tx(ed, 10));
+  }
+
+  CHECK(!leases.back());
+  s->release(leases.front());
+  leases.front() = s->acquire_tx(ed, 10);
+  CHECK(bool(leases.front()));
+
+  for (auto &l : leases)
+  {
+    s->release(l);
+  }
+
+  CHECK(s->pool().statistics().used == used);
+}
+
+} // namespace unit
@@ -0,0 +1,118 @@
+/// \file tx_queue.cpp
+/// Frames are written in batches, those the driver does not take are
+/// retried in order
+
+#include <memory>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+void
+test_tx_queue()
+{
+  auto                s     = std::make_unique<ipv4::stack<>>();
+  wire                w(*s);
+  auto                &st   = s->interfaces()[0].statistics;
+  const std::size_t   queue = ipv4::default_config::tx_queue_size;
+
+  s->set(0, c_local.hw_addr, c_local.ip_addr);
+  resolve(w, 0, c_peer, c_local);
+
+  auto              ed    = s->bind(0, 8000);
+  const std::size_t used  = s->pool().statistics().used;
+
+  // Frames are written in a single call per step
+  for (uint8_t k = 0; k < 3; k++)
+  {
+    s->send(ed, pattern(10, k).data(), 10, { c_peer.ip_addr, 8001 });
+  }
+
+  w.writes = 0;
+  w.step();
+
+  CHECK(w.writes == 1 && w.tx[0].size() == 3);
+
+  // A driver taking one frame per call gets the rest on the next steps,
+  // in order
+  w.tx[0].clear();
+  w.write_limit = 1;
+
+  for (uint8_t k = 0; k < 3; k++)
+  {
+    s->send(ed, pattern(10, k).data(), 10, { c_peer.ip_addr, 8001 });
+  }
+
+  w.step();
+  CHECK(w.tx[0].size() == 1);
+  w.step();
+  w.step();
+  CHECK(w.tx[0].size() == 3);
+
+  for (uint8_t k = 0; k < 3 && k < w.tx[0].size(); k++)
+  {
+    CHECK(is_valid_udp_frame(w.tx[0][k]) && udp_payload(w.tx[0][k]) == pattern(10, k));
+  }
+
+  CHECK(s->pool().statistics().used == used);
+
+  // Replies and datagrams queued while the driver takes nothing are
+  // written in the order they were formed
+  w.tx[0].clear();
+  w.write_limit = 0;
+
+  w.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  w.step();
+  s->send(ed, pattern(10, 1).data(), 10, { c_peer.ip_addr, 8001 });
+  w.step();
+  w.rx[0].push_back(icmp_echo_frame(c_peer, c_local, pattern(32, 2), 7));
+  w.step();
+
+  CHECK(w.tx[0].empty());
+
+  w.write_limit = std::numeric_limits<std::size_t>::max();
+  w.step();
+
+  CHECK(w.tx[0].size() == 3);
+
+  if (w.tx[0].size() == 3)
+  {
+    CHECK(field(w.tx[0][0], 12) == 0x0806);
+    CHECK(is_valid_udp_frame(w.tx[0][1]) && udp_payload(w.tx[0][1]) == pattern(10, 1));
+    CHECK(is_valid_ip_frame(w.tx[0][2]) && w.tx[0][2][23] == 1 && field(w.tx[0][2], 40) == 7);
+  }
+
+  CHECK(s->pool().statistics().used == used);
+
+  // Replies which find the queue full are dropped and counted, datagrams
+  // wait in their descriptors
+  w.tx[0].clear();
+  w.write_limit = 0;
+
+  for (std::size_t k = 0; k < queue + 2; k++)
+  {
+    w.rx[0].push_back(arp_frame(1, c_peer, c_local, c_broadcast));
+  }
+
+  while (!w.rx[0].empty())
+  {
+    w.step();
+  }
+
+  CHECK(st.tx_drops == 2);
+
+  s->send(ed, pattern(10, 3).data(), 10, { c_peer.ip_addr, 8001 });
+  w.step();
+  CHECK(w.tx[0].empty());
+
+  w.write_limit = std::numeric_limits<std::size_t>::max();
+  w.step();
+  CHECK(w.tx[0].size() == queue);
+  w.step();
+  CHECK(w.tx[0].size() == queue + 1);
+  CHECK(udp_payload(w.tx[0].back()) == pattern(10, 3));
+  CHECK(s->pool().statistics().used == used);
+}
+
+} // namespace unit
@@ -0,0 +1,322 @@
+/// \file unit.cpp
+/// Frame builders of the checks
+
+#include <algorithm>
+#include <iostream>
+
+#include "unit.hpp"
+
+namespace unit
+{
+
+namespace
+{
+
+std::size_t g_failures = 0;
+
+void
+put16
+(
+  bytes&            f,
+  const std::size_t offset,
+  const uint16_t    value
+)
+{
+  f[offset]     = uint8_t(value >> 8);
+  f[offset + 1] = uint8_t(value);
+}
+
+template<typename T>
+void
+append
+(
+  bytes&    f,
+  const T&  a
+)
+{
+  f.insert(f.end(), std::begin(a), std::end(a));
+}
+
+/// Ethernet and IP headers of a packet of protocol with size bytes of
+/// payload
+bytes
+ip_frame
+(
+  const host&       src,
+  const host&       dest,
+  const uint8_t     protocol,
+  const uint16_t    identification,
+  const std::size_t size
+)
+{
+  bytes f;
+
+  append(f, dest.hw_addr);
+  append(f, src.hw_addr);
+  f.insert(f.end(), { 0x08, 0x00 });
+  f.insert(f.end(), { 0x45, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x40, protocol, 0x00, 0x00 });
+  append(f, src.ip_addr);
+  append(f, dest.ip_addr);
+  put16(f, 16, uint16_t(20 + size));
+  put16(f, 18, identification);
+  put16(f, 24, reference_checksum(&f[14], 20));
+
+  return f;
+}
+
+void
+pad
+(
+  bytes&  f
+)
+{
+  if (f.size() < 60)
+  {
+    f.resize(60, 0);
+  }
+}
+
+} // namespace
+
+bool
+check
+(
+  const bool  condition,
+  const char  *expression,
+  const char  *file,
+  const int   line
+)
+{
+  if (!condition)
+  {
+    std::cout << file << ":" << line << ": check failed: " << expression << "\n";
+    g_failures++;
+  }
+
+  return condition;
+}
+
+std::size_t
+failures()
+{
+  return g_failures;
+}
+
+uint16_t
+reference_checksum
+(
+  const uint8_t     *data,
+  const std::size_t size,
+  uint32_t          sum
+)
+{
+  for (std::size_t k = 0; k + 1 < size; k += 2)
+  {
+    sum += (uint32_t(data[k]) << 8) | data[k + 1];
+  }
+
+  if (size & 1)
+  {
+    sum += uint32_t(data[size - 1]) << 8;
+  }
+
+  while (sum >> 16)
+  {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+
+  return uint16_t(~sum);
+}
+
+bytes
+pattern
+(
+  const std::size_t size,
+  const uint8_t     seed
+)
+{
+  bytes result(size);
+
+  for (std::size_t k = 0; k < size; k++)
+  {
+    result[k] = uint8_t(k * 7 + seed);
+  }
+
+  return result;
+}
+
+bytes
+udp_frame
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        payload,
+  const udp_options&  o
+)
+{
+  const std::size_t length  = 8 + payload.size();
+  bytes             f       = ip_frame(src, dest, 17, o.identification, length);
+  bytes             pseudo;
+
+  f.insert(f.end(), { 0, 0, 0, 0, 0, 0, 0, 0 });
+  put16(f, 34, o.src_port);
+  put16(f, 36, o.dest_port);
+  put16(f, 38, uint16_t(length));
+  append(f, payload);
+
+  append(pseudo, src.ip_addr);
+  append(pseudo, dest.ip_addr);
+  pseudo.insert(pseudo.end(), { 0, 17, uint8_t(length >> 8), uint8_t(length) });
+  pseudo.insert(pseudo.end(), f.begin() + 34, f.end());
+
+  uint16_t sum = reference_checksum(pseudo.data(), pseudo.size());
+
+  sum = (sum == 0) ? 0xFFFF : sum;
+  sum = o.bad_checksum ? uint16_t(sum ^ 1) : sum;
+  sum = o.no_checksum ? 0 : sum;
+
+  put16(f, 40, sum);
+  pad(f);
+
+  return f;
+}
+
+bytes
+arp_frame
+(
+  const uint16_t            opcode,
+  const host&               sender,
+  const host&               target,
+  const ethernet::address&  dest_hw_addr
+)
+{
+  bytes f;
+
+  append(f, dest_hw_addr);
+  append(f, sender.hw_addr);
+  f.insert(f.end(), { 0x08, 0x06, 0x00, 0x01, 0x08, 0x00, 0x06, 0x04, 0x00, uint8_t(opcode) });
+  append(f, sender.hw_addr);
+  append(f, sender.ip_addr);
+
+  if (opcode == 1)
+  {
+    f.insert(f.end(), 6, 0);
+  }
+  else
+  {
+    append(f, target.hw_addr);
+  }
+
+  append(f, target.ip_addr);
+  pad(f);
+
+  return f;
+}
+
+bytes
+icmp_echo_frame
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        data,
+  const uint16_t      sequence
+)
+{
+  bytes f = ip_frame(src, dest, 1, sequence, 8 + data.size());
+
+  f.insert(f.end(), { 0x08, 0x00, 0x00, 0x00, 0x12, 0x34, 0x00, 0x00 });
+  put16(f, 40, sequence);
+  append(f, data);
+  put16(f, 36, reference_checksum(&f[34], f.size() - 34));
+  pad(f);
+
+  return f;
+}
+
+std::vector<bytes>
+udp_fragments
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        payload,
+  const std::size_t   fragment_size,
+  const udp_options&  o
+)
+{
+  const bytes         whole   = udp_frame(src, dest, payload, o);
+  const std::size_t   size    = 8 + payload.size();
+  std::vector<bytes>  result;
+
+  for (std::size_t offset = 0; offset < size; offset += fragment_size)
+  {
+    const std::size_t n     = std::min(fragment_size, size - offset);
+    const bool        f_mf  = (offset + n < size);
+    bytes             f     = ip_frame(src, dest, 17, o.identification, n);
+
+    put16(f, 20, uint16_t((offset / 8) | (f_mf ? 0x2000 : 0)));
+    put16(f, 24, 0);
+    put16(f, 24, reference_checksum(&f[14], 20));
+    f.insert(f.end(), whole.begin() + 34 + offset, whole.begin() + 34 + offset + n);
+    pad(f);
+
+    result.push_back(f);
+  }
+
+  return result;
+}
+
+uint16_t
+field
+(
+  const bytes&      f,
+  const std::size_t offset
+)
+{
+  return uint16_t((f[offset] << 8) | f[offset + 1]);
+}
+
+bool
+is_valid_ip_frame
+(
+  const bytes&  f
+)
+{
+  return
+    (f.size() >= 34) &&
+    (field(f, 12) == 0x0800) &&
+    (14 + std::size_t(field(f, 16)) <= f.size()) &&
+    (reference_checksum(&f[14], 20) == 0);
+}
+
+bool
+is_valid_udp_frame
+(
+  const bytes&  f
+)
+{
+  bool result = is_valid_ip_frame(f) && (f[23] == 17) && (f.size() >= 42);
+
+  if (result && field(f, 40) != 0)
+  {
+    const std::size_t length = field(f, 38);
+    bytes             pseudo(f.begin() + 26, f.begin() + 34);
+
+    pseudo.insert(pseudo.end(), { 0, 17, uint8_t(length >> 8), uint8_t(length) });
+    pseudo.insert(pseudo.end(), f.begin() + 34, f.begin() + 34 + length);
+
+    result = (reference_checksum(pseudo.data(), pseudo.size()) == 0);
+  }
+
+  return result;
+}
+
+bytes
+udp_payload
+(
+  const bytes&  f
+)
+{
+  return bytes(f.begin() + 42, f.begin() + 34 + field(f, 38));
+}
+
+} // namespace unit
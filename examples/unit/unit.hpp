@@ -0,0 +1,270 @@
+/// \file unit.hpp
+/// Checks of the IPV4 stack: frame builders and a stand-in for the
+/// drivers of the interfaces
+
+#ifndef PROTOCOL_EXAMPLES_UNIT_HPP
+#define PROTOCOL_EXAMPLES_UNIT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <limits>
+
+#include "protocol/ipv4/stack.hpp"
+
+namespace unit
+{
+
+using namespace protocol;
+
+typedef std::vector<uint8_t> bytes;
+
+/// Reports a failed check with its place, returns the condition
+bool
+check
+(
+  const bool  condition,
+  const char  *expression,
+  const char  *file,
+  const int   line
+);
+
+/// Number of failed checks
+std::size_t
+failures();
+
+#define CHECK(c) unit::check((c), #c, __FILE__, __LINE__)
+
+/// Checksum summed one 16 bit word at a time, the reference the stack is
+/// compared to
+uint16_t
+reference_checksum
+(
+  const uint8_t     *data,
+  const std::size_t size,
+  uint32_t          sum = 0
+);
+
+/// size bytes of a pattern starting from seed
+bytes
+pattern
+(
+  const std::size_t size,
+  const uint8_t     seed
+);
+
+struct host
+{
+  ethernet::address hw_addr;
+  ipv4::address     ip_addr;
+};
+
+const ethernet::address c_broadcast = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+/// Peer sending to the stack, and the addresses of the interfaces
+const host c_peer     = { {0x02, 0x00, 0x00, 0x00, 0x00, 0x01}, {10, 0, 0, 1} };
+const host c_local    = { {0x02, 0x00, 0x00, 0x00, 0x00, 0x02}, {10, 0, 0, 2} };
+const host c_local_1  = { {0x02, 0x00, 0x00, 0x00, 0x01, 0x02}, {10, 0, 1, 2} };
+
+struct udp_options
+{
+  uint16_t  src_port        = 8001;
+  uint16_t  dest_port       = 8000;
+  uint16_t  identification  = 1;
+  bool      bad_checksum    = false;
+  bool      no_checksum     = false;
+};
+
+/// UDP datagram from src to dest in a single frame, padded to the minimum
+/// frame size
+bytes
+udp_frame
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        payload,
+  const udp_options&  o = udp_options()
+);
+
+bytes
+arp_frame
+(
+  const uint16_t            opcode,
+  const host&               sender,
+  const host&               target,
+  const ethernet::address&  dest_hw_addr
+);
+
+bytes
+icmp_echo_frame
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        data,
+  const uint16_t      sequence
+);
+
+/// UDP datagram from src to dest split in IP fragments carrying
+/// fragment_size bytes of the datagram each, the last one the rest.
+/// fragment_size is a multiple of 8
+std::vector<bytes>
+udp_fragments
+(
+  const host&         src,
+  const host&         dest,
+  const bytes&        payload,
+  const std::size_t   fragment_size,
+  const udp_options&  o = udp_options()
+);
+
+/// 16 bit field of a frame in network order
+uint16_t
+field
+(
+  const bytes&      f,
+  const std::size_t offset
+);
+
+/// The IP header checksum and the lengths of the frame are valid
+bool
+is_valid_ip_frame
+(
+  const bytes&  f
+);
+
+/// The frame is a valid IP frame and its UDP checksum is valid or zero
+bool
+is_valid_udp_frame
+(
+  const bytes&  f
+);
+
+/// UDP payload of a frame
+bytes
+udp_payload
+(
+  const bytes&  f
+);
+
+/// Stand-in for the drivers of the interfaces of a stack. Frames queued
+/// in rx are read by step() with rx_flags, frames written are kept in tx.
+/// At most write_limit frames are written per call.
+template<typename Stack>
+struct wire
+{
+  explicit
+  wire
+  (
+    Stack&  s
+  )
+  : stack(s),
+    rx(Stack::config::interface_table_size),
+    tx(Stack::config::interface_table_size)
+  {}
+
+  void
+  step()
+  {
+    stack.step
+    (
+      [this](ipv4::interface_designator id) -> bool
+      {
+        return !rx[id].empty();
+      },
+      [this](ipv4::interface_designator id, ipv4::frame *frames, const std::size_t count) -> std::size_t
+      {
+        std::size_t n = 0;
+
+        reads++;
+
+        while (n < count && !rx[id].empty())
+        {
+          const bytes &f = rx[id].front();
+
+          // A frame larger than the buffer is dropped like a NIC does
+          if (f.size() <= frames[n].capacity)
+          {
+            std::memcpy(frames[n].data, f.data(), f.size());
+            frames[n].size  = f.size();
+            frames[n].flags = rx_flags;
+            n++;
+          }
+
+          rx[id].pop_front();
+        }
+
+        return n;
+      },
+      [this](ipv4::interface_designator id, const ipv4::frame *frames, const std::size_t count) -> std::size_t
+      {
+        const std::size_t n = std::min(count, write_limit);
+
+        writes++;
+
+        for (std::size_t k = 0; k < n; k++)
+        {
+          tx[id].push_back(bytes(frames[k].data, frames[k].data + frames[k].size));
+        }
+
+        return n;
+      }
+    );
+  }
+
+  Stack                             &stack;
+  std::vector<std::deque<bytes>>    rx;
+  std::vector<std::vector<bytes>>   tx;
+  ipv4::frame_flags_t               rx_flags;
+  std::size_t                       write_limit = std::numeric_limits<std::size_t>::max();
+  std::size_t                       reads       = 0;
+  std::size_t                       writes      = 0;
+};
+
+/// Teaches the interface designated by id the hardware address of the
+/// peer, its ARP request is answered and the frames written are cleared
+template<typename Stack>
+void
+resolve
+(
+  wire<Stack>&                      w,
+  const ipv4::interface_designator  id,
+  const host&                       peer,
+  const host&                       local
+)
+{
+  w.rx[id].push_back(arp_frame(1, peer, local, c_broadcast));
+  w.step();
+  w.tx[id].clear();
+}
+
+void test_interfaces();
+void test_instances();
+void test_arp_cache();
+void test_arp_resolution();
+void test_port_demux();
+void test_rx_lease();
+void test_tx_lease();
+void test_allocator();
+void test_burst();
+void test_tx_queue();
+void test_checksum();
+void test_checksum_copy();
+void test_echo();
+void test_offload();
+void test_connected();
+void test_parse();
+void test_read_only();
+void test_endian();
+void test_config();
+void test_descriptors();
+void test_reassembly();
+void test_fragmentation();
+void test_mtu();
+void test_frame_pool();
+void test_deliver();
+
+} // namespace unit
+
+//  PROTOCOL_EXAMPLES_UNIT_HPP
+#endif
@@ -0,0 +1,437 @@
+/// \file allocator.hpp
+/// Constant time payload buffer allocator
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+
+#ifndef PROTOCOL_IPV4_ALLOCATOR_HPP
+#define PROTOCOL_IPV4_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Index of the least significant bit set, v shall not be zero
+inline unsigned 
+find_first_set
+(
+  const uint32_t  v
+)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz(v);
+#else
+  unsigned result = 0;
+  
+  while (((v >> result) & 1) == 0)
+  {
+    result++;
+  }
+  
+  return result;
+#endif
+}
+
+/// Size of the header in front of each block of a payload_allocator
+constexpr std::size_t c_allocator_header_size = 4;
+
+/// Buffer size of a payload_allocator holding an allocation of size bytes,
+/// i.e. the block header and the rounding to granules included
+template<std::size_t Granule = 16>
+constexpr std::size_t
+payload_allocation_size
+(
+  const std::size_t size
+)
+{
+  return ((size + c_allocator_header_size + Granule - 1) / Granule) * Granule;
+}
+
+struct allocator_statistics
+{
+  std::size_t   capacity      = 0;
+  /// bytes allocated including the block headers
+  std::size_t   used          = 0;
+  std::size_t   high_water    = 0;
+  /// size of the largest free block, an allocation up to this size (less 
+  /// the block header) succeeds
+  std::size_t   largest_free  = 0;
+  std::size_t   allocations   = 0;
+  std::size_t   failures      = 0;
+};
+
+/// Allocator of a fixed size buffer with constant time allocation and 
+/// release. The buffer is managed in blocks of Granule bytes, each block 
+/// starts with a header keeping its size, the start of the physically 
+/// previous block and the free flag. Free blocks are kept in segregated 
+/// lists, one per power of two size class, and a bitmap of the non-empty
+/// lists. An allocation takes the first block of the smallest class whose
+/// blocks are all large enough, so it is found with a single bit scan. 
+/// Released blocks are merged with free physical neighbours right away.
+template
+<
+  std::size_t Size,
+  std::size_t Granule = 16
+>
+class payload_allocator
+{
+  static constexpr unsigned log2(const std::size_t n)
+  {
+    return (n <= 1) ? 0 : 1 + log2(n >> 1);
+  }
+
+  static constexpr std::size_t c_granules     = Size / Granule;
+  static constexpr std::size_t c_classes      = log2(c_granules) + 1;
+  static constexpr std::size_t c_header_size  = c_allocator_header_size;
+  
+  static constexpr uint16_t    c_free_bit     = 0x8000;
+  static constexpr uint16_t    c_nil          = 0xFFFF;
+  
+  static_assert((Granule & (Granule - 1)) == 0, "Granule shall be a power of two");
+  static_assert(Granule >= 2 * c_header_size, "Granule shall hold the free list links");
+  static_assert(Size % Granule == 0, "Size shall be a multiple of Granule");
+  static_assert(c_granules > 0 && c_granules < c_free_bit, "Size out of range");
+  static_assert(c_classes <= 32, "Size out of range");
+
+public: // Constructors and Destructor
+
+  payload_allocator()
+  {
+    reset();
+  }
+
+  payload_allocator(const payload_allocator&) = delete;
+
+public: // Methods
+
+  /// Returns the first byte of size bytes, nullptr if there is no free 
+  /// block large enough
+  uint8_t*
+  allocate
+  (
+    const std::size_t size
+  )
+  {
+    uint8_t     *result = nullptr;
+    std::size_t n       = (size + c_header_size + Granule - 1) / Granule;
+    uint16_t    b       = c_nil;
+    
+    if (n <= c_granules)
+    {
+      // smallest class whose blocks are all at least n granules
+      unsigned  c     = log2(n) + (((n & (n - 1)) != 0) ? 1 : 0);
+      uint32_t  mask  = (c < 32) ? (bitmap_ & ~((uint32_t(1) << c) - 1)) : 0;
+      
+      if (mask != 0)
+      {
+        b = heads_[find_first_set(mask)];
+      }
+      else
+      {
+        // blocks of the class of n may still be large enough
+        uint16_t h = heads_[log2(n)];
+        
+        if (h != c_nil && block_size(h) >= n)
+        {
+          b = h;
+        }
+      }
+    }
+
+    if (b != c_nil)
+    {
+      remove_free(b);
+
+      std::size_t m = block_size(b);
+      
+      if (m > n)
+      {
+        // split, the remainder is a new free block
+        uint16_t r = uint16_t(b + n);
+        
+        set_block(r, uint16_t(m - n), b, true);
+        set_prev_of_next(r);
+        insert_free(r);
+      }
+      
+      set_block(b, uint16_t(n), block_prev(b), false);
+
+      statistics_.used       += n * Granule;
+      statistics_.high_water  = std::max(statistics_.high_water, statistics_.used);
+      statistics_.allocations++;
+      
+      result = &buffer_[b * Granule + c_header_size];
+    }
+    else
+    {
+      statistics_.failures++;
+    }
+    
+    return result;
+  }
+
+  /// Returns the block of ptr, which shall be allocated by this allocator
+  void
+  release
+  (
+    uint8_t   *ptr
+  )
+  {
+    uint16_t    b = uint16_t((ptr - &buffer_[c_header_size]) / Granule);
+    std::size_t n = block_size(b);
+    uint16_t    p = block_prev(b);
+    
+    statistics_.used -= n * Granule;
+
+    // merge with the next block
+    if (b + n < c_granules && is_free(uint16_t(b + n)))
+    {
+      uint16_t next = uint16_t(b + n);
+      
+      remove_free(next);
+      n += block_size(next);
+    }
+
+    // merge with the previous block
+    if (p != c_nil && is_free(p))
+    {
+      remove_free(p);
+      n += block_size(p);
+      b  = p;
+    }
+    
+    set_block(b, uint16_t(n), block_prev(b), true);
+    set_prev_of_next(b);
+    insert_free(b);
+  }
+
+  /// Shrinks the block of ptr to size bytes, the rest of the block is 
+  /// released. The block shall be allocated by this allocator with at 
+  /// least size bytes
+  void
+  shrink
+  (
+    uint8_t           *ptr,
+    const std::size_t size
+  )
+  {
+    uint16_t    b = uint16_t((ptr - &buffer_[c_header_size]) / Granule);
+    std::size_t m = block_size(b);
+    std::size_t n = (size + c_header_size + Granule - 1) / Granule;
+    
+    if (m > n)
+    {
+      uint16_t    r     = uint16_t(b + n);
+      std::size_t rest  = m - n;
+
+      statistics_.used -= rest * Granule;
+      
+      set_block(b, uint16_t(n), block_prev(b), false);
+
+      // merge the remainder with the next block
+      if (b + m < c_granules && is_free(uint16_t(b + m)))
+      {
+        uint16_t next = uint16_t(b + m);
+        
+        remove_free(next);
+        rest += block_size(next);
+      }
+      
+      set_block(r, uint16_t(rest), b, true);
+      set_prev_of_next(r);
+      insert_free(r);
+    }
+  }
+
+  void
+  reset()
+  {
+    heads_.fill(c_nil);
+    bitmap_     = 0;
+    statistics_ = allocator_statistics();
+
+    statistics_.capacity = Size;
+
+    set_block(0, uint16_t(c_granules), c_nil, true);
+    insert_free(0);
+  }
+
+  bool
+  contains
+  (
+    const uint8_t *ptr
+  ) const
+  {
+    return (ptr >= buffer_.data()) && (ptr < buffer_.data() + Size);
+  }
+
+  /// Returns the statistics, the largest free block is searched in the 
+  /// highest non-empty class
+  allocator_statistics
+  statistics() const
+  {
+    allocator_statistics result = statistics_;
+    
+    result.largest_free = 0;
+    
+    if (bitmap_ != 0)
+    {
+      uint16_t b = heads_[log2(bitmap_)];
+      
+      for (; b != c_nil; b = link_next(b))
+      {
+        result.largest_free = std::max(result.largest_free, block_size(b) * Granule);
+      }
+    }
+    
+    return result;
+  }
+
+private: // Methods
+
+  uint16_t load(const std::size_t offset) const
+  {
+    uint16_t result;
+    std::memcpy(&result, &buffer_[offset], sizeof(result));
+    return result;
+  }
+
+  void store(const std::size_t offset, const uint16_t value)
+  {
+    std::memcpy(&buffer_[offset], &value, sizeof(value));
+  }
+
+  /// Block header: size | free bit, prev
+  /// Free block:   size | free bit, prev, next free, prev free
+
+  std::size_t block_size(const uint16_t b) const
+  {
+    return load(b * Granule) & ~c_free_bit;
+  }
+
+  bool is_free(const uint16_t b) const
+  {
+    return (load(b * Granule) & c_free_bit) != 0;
+  }
+
+  uint16_t block_prev(const uint16_t b) const
+  {
+    return load(b * Granule + 2);
+  }
+
+  uint16_t link_next(const uint16_t b) const
+  {
+    return load(b * Granule + 4);
+  }
+
+  uint16_t link_prev(const uint16_t b) const
+  {
+    return load(b * Granule + 6);
+  }
+
+  void set_block(const uint16_t b, const uint16_t size, const uint16_t prev, const bool f_free)
+  {
+    store(b * Granule,      f_free ? (size | c_free_bit) : size);
+    store(b * Granule + 2,  prev);
+  }
+
+  void set_prev_of_next(const uint16_t b)
+  {
+    std::size_t next = b + block_size(b);
+    
+    if (next < c_granules)
+    {
+      store(next * Granule + 2, b);
+    }
+  }
+
+  void insert_free(const uint16_t b)
+  {
+    unsigned  c     = log2(block_size(b));
+    uint16_t  head  = heads_[c];
+    
+    store(b * Granule + 4, head);
+    store(b * Granule + 6, c_nil);
+    
+    if (head != c_nil)
+    {
+      store(head * Granule + 6, b);
+    }
+    
+    heads_[c]  = b;
+    bitmap_   |= uint32_t(1) << c;
+  }
+
+  void remove_free(const uint16_t b)
+  {
+    unsigned  c     = log2(block_size(b));
+    uint16_t  next  = link_next(b);
+    uint16_t  prev  = link_prev(b);
+    
+    if (prev != c_nil)
+    {
+      store(prev * Granule + 4, next);
+    }
+    else
+    {
+      heads_[c] = next;
+    }
+    
+    if (next != c_nil)
+    {
+      store(next * Granule + 6, prev);
+    }
+    
+    if (heads_[c] == c_nil)
+    {
+      bitmap_ &= ~(uint32_t(1) << c);
+    }
+  }
+
+private: // Members
+
+  std::array<uint8_t, Size>           buffer_;
+  std::array<uint16_t, c_classes>     heads_;
+  uint32_t                            bitmap_;
+  allocator_statistics                statistics_;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_ALLOCATOR_HPP
+#endif 
@@ -0,0 +1,308 @@
+/// \file arp_cache.hpp
+/// Hashed ARP cache with aging and clock replacement
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+
+#ifndef PROTOCOL_IPV4_ARP_CACHE_HPP
+#define PROTOCOL_IPV4_ARP_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <optional>
+#include <functional>
+
+#include "address.hpp"
+#include "../ethernet/address.hpp"
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Time in number of stack steps
+typedef uint32_t  time_point;
+
+/// Fixed capacity open addressing cache keyed on the IP address. An 
+/// address is only ever stored within ProbeLimit slots from its home slot, 
+/// so lookup and insertion cost is bounded regardless of the capacity.
+/// When all slots of the probe window are occupied, an entry is replaced
+/// by clock (second chance) algorithm: entries referenced since the last
+/// sweep are skipped once.
+/// Entries expire after Lifetime steps from their last update, incomplete 
+/// entries after IncompleteLifetime steps.
+/// The generation of the cache changes whenever a mapping is created, 
+/// changed or removed, so that copies of the mappings can be validated 
+/// without a lookup.
+template
+<
+  typename    Entry,
+  std::size_t Size,
+  std::size_t ProbeLimit          = 8,
+  time_point  Lifetime            = 60000,
+  time_point  IncompleteLifetime  = 1000
+>
+class arp_cache
+{
+  static_assert((Size & (Size - 1)) == 0, "Size shall be a power of two");
+  static_assert(ProbeLimit <= Size, "ProbeLimit shall not exceed Size");
+
+public: // Types
+
+  typedef Entry                                         entry;
+  typedef std::optional<std::reference_wrapper<Entry>>  entry_ref;
+  
+public: // Constructors and Destructor
+
+  arp_cache()
+  : now_(0),
+    hand_(0),
+    generation_(0)
+  {}
+
+public: // Methods
+
+  /// Returns the entry of the address if it exists and it is not expired
+  entry_ref
+  find
+  (
+    const address&  a
+  )
+  {
+    entry_ref result;
+    
+    std::size_t index = home(a);
+
+    for (std::size_t n = 0; n < ProbeLimit; n++, index = next(index))
+    {
+      entry &e = entries_[index];
+
+      if (e.is_occupied() && e.ip_addr == a)
+      {
+        if (is_expired(e))
+        {
+          e.clear_occupied();
+        }
+        else
+        {
+          e.set_referenced();
+          result = e;
+          break;
+        }
+      }
+    }
+    
+    return result;
+  }
+
+  /// Updates the entry of the address, a new entry is created if it does 
+  /// not exist. Updating resets the age of the entry.
+  entry_ref
+  update
+  (
+    const ethernet::address&  hwa,
+    const address&            ipa,
+    const bool                f_complete
+  )
+  {
+    entry_ref   result;
+    std::size_t index     = home(ipa);
+    std::size_t candidate = Size;
+
+    for (std::size_t n = 0; n < ProbeLimit; n++, index = next(index))
+    {
+      entry &e = entries_[index];
+
+      if (e.is_occupied() && !is_expired(e))
+      {
+        if (e.ip_addr == ipa)
+        {
+          candidate = index;
+          break;
+        }
+      }
+      else if (candidate == Size)
+      {
+        // first free slot in the window
+        candidate = index;
+      }
+    }
+
+    if (candidate == Size)
+    {
+      candidate = replace(home(ipa));
+    }
+
+    entry &e = entries_[candidate];
+    
+    if 
+    (
+      !e.is_occupied() || 
+      (e.ip_addr != ipa) || 
+      (e.hw_addr != hwa) || 
+      (e.is_complete() != f_complete)
+    )
+    {
+      generation_++;
+    }
+    
+    e = entry(hwa, ipa, f_complete);
+    e.set_occupied();
+    e.elapsed = now_;
+    
+    result = e;
+
+    return result;
+  }
+
+  /// Removes the entry of the address
+  void
+  remove
+  (
+    const address&  a
+  )
+  {
+    auto e_ref = find(a);
+
+    if (e_ref)
+    {
+      e_ref->get().clear_occupied();
+      generation_++;
+    }
+  }
+
+  /// Advances the time of the cache by one step
+  void tick()
+  {
+    now_++;
+  }
+  
+  time_point now() const
+  {
+    return now_;
+  }
+  
+  uint32_t generation() const
+  {
+    return generation_;
+  }
+  
+  void clear()
+  {
+    for (auto &e : entries_)
+    {
+      e.clear_occupied();
+    }
+    
+    generation_++;
+  }
+
+  static constexpr time_point lifetime()
+  {
+    return Lifetime;
+  }
+
+  static constexpr std::size_t capacity()
+  {
+    return Size;
+  }
+
+private: // Methods
+
+  static constexpr unsigned log2(const std::size_t n)
+  {
+    return (n <= 1) ? 0 : 1 + log2(n >> 1);
+  }
+
+  static std::size_t home(const address& a)
+  {
+    uint32_t v;
+    
+    // The address may be a field of a received frame, which is not 
+    // aligned for a 32 bit load
+    std::memcpy(&v, a.data(), sizeof(v));
+    
+    // Fibonacci hashing, upper bits of the product are the best mixed
+    uint32_t h = v * 2654435769U;
+    
+    return (Size > 1) ? (h >> (32 - log2(Size))) : 0;
+  }
+
+  static std::size_t next(const std::size_t index)
+  {
+    return (index + 1) & (Size - 1);
+  }
+
+  bool is_expired(const entry& e) const
+  {
+    time_point age = now_ - e.elapsed;
+
+    return e.is_complete() ? (age >= Lifetime) : (age >= IncompleteLifetime);
+  }
+
+  /// Selects the entry to be replaced in the probe window starting from 
+  /// index. The hand keeps the position of the sweep between calls.
+  std::size_t replace(const std::size_t index)
+  {
+    for (std::size_t n = 0; n < 2 * ProbeLimit; n++)
+    {
+      std::size_t i = (index + hand_) & (Size - 1);
+      entry       &e = entries_[i];
+
+      hand_ = (hand_ + 1) % ProbeLimit;
+
+      if (e.is_referenced())
+      {
+        e.clear_referenced();
+      }
+      else
+      {
+        return i;
+      }
+    }
+    // unreachable, every entry is unreferenced after the first lap
+    return index;
+  }
+
+private: // Members
+
+  std::array<entry, Size>   entries_;
+  time_point                now_;
+  std::size_t               hand_;
+  uint32_t                  generation_;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_ARP_CACHE_HPP
+#endif 
@@ -33,6 +33,7 @@ For more information, please refer to <http://unlicense.org>
 #define PROTOCOL_IPV4_BD_HPP
 
 #include "types.hpp"
+#include "defs.hpp"
 
 namespace protocol
 {
@@ -40,28 +41,255 @@ namespace protocol
 namespace ipv4
 {
   
-extern 
+template<typename Config>
 void 
 invalidate_descriptors
 (
-  buffer_descriptor_container   &descriptors
-);
+  buffer_descriptor_container<Config>   &descriptors
+)
+{
+  for (auto &d : descriptors)
+  {
+    d.flags.template clear<valid>();
+  }
+  
+  descriptors.reset();
+}
 
-extern 
-void 
-reset_descriptor_ranges
+template<typename Config>
+buffer_descriptor_ref<Config>
+find_available_bd
 (
-  payload_buffer_container      &payload_buffer,
-  buffer_descriptor_container   &descriptors
-);
- 
-extern buffer_descriptor_ref
+  buffer_descriptor_container<Config>   &descriptors
+)
+{
+  buffer_descriptor_ref<Config>   result;
+  
+  const std::size_t k = descriptors.find_free();
+  
+  if (k < descriptors.size())
+  {
+    result = std::ref(descriptors[k]);
+  }
+  
+  return result;
+}
+
+/// Allocates a buffer descriptor with size bytes from the payload buffer
+template<typename Config>
+buffer_descriptor_ref<Config>
 allocate_bd
 (
-  payload_buffer_container    &payload_buffer,
-  buffer_descriptor_container &descriptors,
+  payload_buffer_container<Config>    &payload_buffer,
+  buffer_descriptor_container<Config> &descriptors,
+  const std::size_t                   size
+)
+{
+  buffer_descriptor_ref<Config> result;
+  
+  auto bd_ref = 
+    find_available_bd<Config>
+    (
+      descriptors
+    );
+
+  if (bd_ref)
+  {
+    uint8_t *ptr = payload_buffer.allocate(size);
+    
+    if (ptr != nullptr)
+    {
+      buffer_descriptor<Config> &bd = *bd_ref;
+      
+      bd.flags.template set<valid>();
+      bd.flags.template clear<pending, transmit, summed>();
+      bd.first      = ptr;
+      bd.last       = ptr + size;
+      bd.offset     = 0;
+      bd.size       = size;
+      bd.fragments  = 1;
+      bd.buffer     = &payload_buffer;
+      bd.container  = &descriptors;
+      bd.flow_ref.reset();
+      descriptors.update(bd);
+      
+      TRACE("BD:" 
+            << std::hex
+            << uintptr_t(bd.first) << " , " 
+            << uintptr_t(bd.last) << " , " 
+            << std::dec 
+            << bd.size << "\n");
+    
+      result = bd_ref;
+    }
+    else
+    {
+      TRACE( "No available payload buffer\n" );
+    }
+  }
+  else
+  {
+    TRACE( "No available Buffer Descriptor\n" );
+  }
+  return result;
+}
+
+/// Allocates a buffer descriptor taking over the block of a frame read
+/// into the payload buffer. The block is shrunk to the end of the payload
+/// of size bytes at offset, so the descriptor holds no more than the frame
+template<typename Config>
+buffer_descriptor_ref<Config>
+adopt_bd
+(
+  payload_buffer_container<Config>    &payload_buffer,
+  buffer_descriptor_container<Config> &descriptors,
+  uint8_t                             *block,
+  const std::size_t                   offset,
+  const std::size_t                   size
+)
+{
+  auto bd_ref =
+    find_available_bd<Config>
+    (
+      descriptors
+    );
+
+  if (bd_ref)
+  {
+    buffer_descriptor<Config> &bd = *bd_ref;
+
+    payload_buffer.shrink(block, offset + size);
+
+    bd.flags.template set<valid>();
+    bd.flags.template clear<pending, transmit, summed>();
+    bd.first      = block;
+    bd.last       = block + offset + size;
+    bd.offset     = offset;
+    bd.size       = size;
+    bd.fragments  = 1;
+    bd.buffer     = &payload_buffer;
+    bd.container  = &descriptors;
+    bd.flow_ref.reset();
+    descriptors.update(bd);
+  }
+  else
+  {
+    TRACE( "No available Buffer Descriptor\n" );
+  }
+
+  return bd_ref;
+}
+
+/// Allocates a buffer descriptor taking over a frame of the driver. The 
+/// frame is returned through release when the descriptor is released
+template<typename Config>
+buffer_descriptor_ref<Config>
+adopt_bd
+(
+  buffer_descriptor_container<Config> &descriptors,
+  const frame_handle                  &handle,
+  frame_release_function              release,
+  const std::size_t                   offset,
+  const std::size_t                   size
+)
+{
+  auto bd_ref =
+    find_available_bd<Config>
+    (
+      descriptors
+    );
+
+  if (bd_ref)
+  {
+    buffer_descriptor<Config> &bd = *bd_ref;
+
+    bd.flags.template set<valid>();
+    bd.flags.template clear<pending, transmit, summed>();
+    bd.first      = handle.data;
+    bd.last       = handle.data + handle.size;
+    bd.offset     = offset;
+    bd.size       = size;
+    bd.fragments  = 1;
+    bd.buffer     = nullptr;
+    bd.container  = &descriptors;
+    bd.handle     = handle;
+    bd.release    = release;
+    bd.flow_ref.reset();
+    descriptors.update(bd);
+  }
+  else
+  {
+    TRACE( "No available Buffer Descriptor\n" );
+  }
+
+  return bd_ref;
+}
+
+/// Returns the payload of the descriptor to its buffer, or its frame to 
+/// the driver, and invalidates the descriptor
+template<typename Config>
+void
+release_bd
+(
+  buffer_descriptor<Config>   &bd
+)
+{
+  const bool f_valid = bd.flags.template test<valid>();
+  
+  bd.flags.template clear<valid, pending, transmit, summed>();
+
+  if (f_valid)
+  {
+    if (bd.buffer != nullptr)
+    {
+      bd.buffer->release(bd.first);
+    }
+    else
+    {
+      bd.release(bd.handle);
+    }
+    
+    bd.container->update(bd);
+  }
+}
+
+/// Returns the payload of the descriptor beyond size bytes to its buffer
+template<typename Config>
+void
+shrink_bd
+(
+  buffer_descriptor<Config>   &bd,
   const std::size_t           size
-);
+)
+{
+  bd.buffer->shrink(bd.first, size);
+  bd.last = bd.first + size;
+  bd.size = size;
+}
+
+/// Sets the flags of the descriptor and mirrors them in its container
+template<typename... Flags, typename Config>
+void
+set_flags
+(
+  buffer_descriptor<Config>   &bd
+)
+{
+  bd.flags.template set<Flags...>();
+  bd.container->update(bd);
+}
+
+/// Clears the flags of the descriptor and mirrors them in its container
+template<typename... Flags, typename Config>
+void
+clear_flags
+(
+  buffer_descriptor<Config>   &bd
+)
+{
+  bd.flags.template clear<Flags...>();
+  bd.container->update(bd);
+}
 
 } // namespace ipv4
 
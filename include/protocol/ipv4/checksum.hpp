@@ -0,0 +1,489 @@
+/// \file checksum.hpp
+/// Internet checksum (RFC 1071) engine
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+
+#ifndef PROTOCOL_IPV4_CHECKSUM_HPP
+#define PROTOCOL_IPV4_CHECKSUM_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "endian.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// The one's complement sum is independent of the byte order and of the 
+/// width of the words added, as long as the sum is folded at the end. 
+/// Kernels add 32 bit words into 64 bit accumulators, which cannot 
+/// overflow for any frame size, and produce bit identical sums once 
+/// folded. An odd trailing byte is padded with zero, therefore only the
+/// last block of a checksum may have an odd size.
+
+inline uint64_t
+load_u32
+(
+  const uint8_t   *p
+)
+{
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/// Adds the remaining bytes, less than a 32 bit word
+inline uint64_t
+checksum_add_tail
+(
+  uint64_t          sum,
+  const uint8_t     *p,
+  std::size_t       size
+)
+{
+  if (size >= 2)
+  {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    sum  += v;
+    p    += 2;
+    size -= 2;
+  }
+
+  if (size == 1)
+  {
+    uint16_t v = 0;
+    std::memcpy(&v, p, 1);
+    sum += v;
+  }
+
+  return sum;
+}
+
+inline uint64_t
+checksum_add_portable
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+  const uint8_t *p  = static_cast<const uint8_t*>(data);
+  uint64_t      s0  = 0;
+  uint64_t      s1  = 0;
+  uint64_t      s2  = 0;
+  uint64_t      s3  = 0;
+
+  for (; size >= 16; p += 16, size -= 16)
+  {
+    s0 += load_u32(p);
+    s1 += load_u32(p + 4);
+    s2 += load_u32(p + 8);
+    s3 += load_u32(p + 12);
+  }
+
+  for (; size >= 4; p += 4, size -= 4)
+  {
+    s0 += load_u32(p);
+  }
+
+  return checksum_add_tail(sum + s0 + s1 + s2 + s3, p, size);
+}
+
+#if defined(__SSE2__)
+
+inline uint64_t
+checksum_add_sse2
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+  const uint8_t *p    = static_cast<const uint8_t*>(data);
+  const __m128i zero  = _mm_setzero_si128();
+  __m128i       acc0  = _mm_setzero_si128();
+  __m128i       acc1  = _mm_setzero_si128();
+
+  // 32 bit lanes are widened to 64 bits before they are added
+  for (; size >= 32; p += 32, size -= 32)
+  {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+
+  return checksum_add_portable(sum + lanes[0] + lanes[1], p, size);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline uint64_t
+checksum_add_avx2
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+  const uint8_t *p    = static_cast<const uint8_t*>(data);
+  const __m256i zero  = _mm256_setzero_si256();
+  __m256i       acc0  = _mm256_setzero_si256();
+  __m256i       acc1  = _mm256_setzero_si256();
+
+  for (; size >= 32; p += 32, size -= 32)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+
+  return checksum_add_sse2(sum + lanes[0] + lanes[1] + lanes[2] + lanes[3], p, size);
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+inline uint64_t
+checksum_add_neon
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+  const uint8_t *p    = static_cast<const uint8_t*>(data);
+  uint64x2_t    acc0  = vdupq_n_u64(0);
+  uint64x2_t    acc1  = vdupq_n_u64(0);
+
+  // Pairs of 32 bit lanes are added into 64 bit lanes
+  for (; size >= 32; p += 32, size -= 32)
+  {
+    acc0 = vpadalq_u32(acc0, vreinterpretq_u32_u8(vld1q_u8(p)));
+    acc1 = vpadalq_u32(acc1, vreinterpretq_u32_u8(vld1q_u8(p + 16)));
+  }
+
+  acc0 = vaddq_u64(acc0, acc1);
+
+  return checksum_add_portable(sum + vgetq_lane_u64(acc0, 0) + vgetq_lane_u64(acc0, 1), p, size);
+}
+
+#endif
+
+/// Adds size bytes of data to the unfolded sum. The kernel is selected at
+/// compile time by the instruction sets enabled for the target
+inline uint64_t
+checksum_add
+(
+  uint64_t          sum,
+  const void        *data,
+  std::size_t       size
+)
+{
+#if defined(__AVX2__)
+  return checksum_add_avx2(sum, data, size);
+#elif defined(__SSE2__)
+  return checksum_add_sse2(sum, data, size);
+#elif defined(__ARM_NEON)
+  return checksum_add_neon(sum, data, size);
+#else
+  return checksum_add_portable(sum, data, size);
+#endif
+}
+
+/// Copy kernels add the words to the sum while they are copied, so the 
+/// data is read once. The same rules as checksum_add apply to the sum.
+
+inline uint64_t
+checksum_copy_portable
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+  uint8_t       *d  = static_cast<uint8_t*>(dest);
+  const uint8_t *p  = static_cast<const uint8_t*>(src);
+  uint64_t      s0  = 0;
+  uint64_t      s1  = 0;
+
+  for (; size >= 8; p += 8, d += 8, size -= 8)
+  {
+    uint32_t w[2];
+    std::memcpy(w, p, sizeof(w));
+    std::memcpy(d, w, sizeof(w));
+    s0 += w[0];
+    s1 += w[1];
+  }
+
+  if (size >= 4)
+  {
+    s0 += load_u32(p);
+    std::memcpy(d, p, 4);
+    p    += 4;
+    d    += 4;
+    size -= 4;
+  }
+
+  std::memcpy(d, p, size);
+
+  return checksum_add_tail(sum + s0 + s1, p, size);
+}
+
+#if defined(__SSE2__)
+
+inline uint64_t
+checksum_copy_sse2
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+  uint8_t       *d    = static_cast<uint8_t*>(dest);
+  const uint8_t *p    = static_cast<const uint8_t*>(src);
+  const __m128i zero  = _mm_setzero_si128();
+  __m128i       acc0  = _mm_setzero_si128();
+  __m128i       acc1  = _mm_setzero_si128();
+
+  for (; size >= 32; p += 32, d += 32, size -= 32)
+  {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d), v0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), v1);
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+    acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+    acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+
+  return checksum_copy_portable(sum + lanes[0] + lanes[1], d, p, size);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline uint64_t
+checksum_copy_avx2
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+  uint8_t       *d    = static_cast<uint8_t*>(dest);
+  const uint8_t *p    = static_cast<const uint8_t*>(src);
+  const __m256i zero  = _mm256_setzero_si256();
+  __m256i       acc0  = _mm256_setzero_si256();
+  __m256i       acc1  = _mm256_setzero_si256();
+
+  for (; size >= 32; p += 32, d += 32, size -= 32)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), v);
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+
+  return checksum_copy_sse2(sum + lanes[0] + lanes[1] + lanes[2] + lanes[3], d, p, size);
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+inline uint64_t
+checksum_copy_neon
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+  uint8_t       *d    = static_cast<uint8_t*>(dest);
+  const uint8_t *p    = static_cast<const uint8_t*>(src);
+  uint64x2_t    acc   = vdupq_n_u64(0);
+
+  for (; size >= 16; p += 16, d += 16, size -= 16)
+  {
+    uint8x16_t v = vld1q_u8(p);
+    vst1q_u8(d, v);
+    acc = vpadalq_u32(acc, vreinterpretq_u32_u8(v));
+  }
+
+  return checksum_copy_portable(sum + vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1), d, p, size);
+}
+
+#endif
+
+/// Copies size bytes from src to dest and adds them to the unfolded sum. 
+/// The ranges must not overlap
+inline uint64_t
+checksum_copy
+(
+  uint64_t          sum,
+  void              *dest,
+  const void        *src,
+  std::size_t       size
+)
+{
+#if defined(__AVX2__)
+  return checksum_copy_avx2(sum, dest, src, size);
+#elif defined(__SSE2__)
+  return checksum_copy_sse2(sum, dest, src, size);
+#elif defined(__ARM_NEON)
+  return checksum_copy_neon(sum, dest, src, size);
+#else
+  return checksum_copy_portable(sum, dest, src, size);
+#endif
+}
+
+/// Folds the sum to 16 bits, without complementing it
+inline uint16_t
+checksum_fold
+(
+  uint64_t    sum
+)
+{
+  sum = (sum >> 32) + (sum & 0xFFFFFFFFU);
+  sum = (sum >> 32) + (sum & 0xFFFFFFFFU);
+  sum = (sum >> 16) + (sum & 0xFFFFU);
+  sum = (sum >> 16) + (sum & 0xFFFFU);
+  sum = (sum >> 16) + (sum & 0xFFFFU);
+  
+  return uint16_t(sum);
+}
+
+/// Updates the checksum of a header, whose 16 bit field changes from 
+/// old_value to new_value, without summing the header again (RFC 1624, 
+/// eqn. 3). Values are in network order like the checksum
+inline uint16_t
+checksum_update
+(
+  const uint16_t  checksum,
+  const uint16_t  old_value,
+  const uint16_t  new_value
+)
+{
+  uint64_t sum = uint16_t(~checksum);
+
+  sum += uint16_t(~old_value);
+  sum += new_value;
+
+  return ~checksum_fold(sum);
+}
+
+/// Updates the checksum for a block of fields, e.g. an address, which 
+/// changes from old_data to new_data. The size must be even
+inline uint16_t
+checksum_update
+(
+  const uint16_t  checksum,
+  const void      *old_data,
+  const void      *new_data,
+  std::size_t     size
+)
+{
+  uint64_t sum = uint16_t(~checksum);
+
+  sum += uint16_t(~checksum_fold(checksum_add(0U, old_data, size)));
+  sum  = checksum_add(sum, new_data, size);
+
+  return ~checksum_fold(sum);
+}
+
+/// Checksum of consecutive blocks, e.g. pseudo header, header and payload
+struct checksum
+{
+  void append(const uint16_t p_value)
+  {
+    sum += p_value;
+  }
+
+  void append(const be16 p_value)
+  {
+    sum += p_value.raw();
+  }
+
+  template<typename T>
+  void append(const T *p_ptr, const unsigned p_size_in_bytes)
+  {
+    sum = checksum_add(sum, p_ptr, p_size_in_bytes);
+  }
+  
+  uint16_t finalize()
+  {
+    return ~checksum_fold(sum);
+  }
+  
+  uint64_t sum = 0U;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_CHECKSUM_HPP
+#endif 
@@ -0,0 +1,129 @@
+/// \file config.hpp
+/// Configuration of IPV4 stack instances
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+#ifndef PROTOCOL_IPV4_CONFIG_HPP
+#define PROTOCOL_IPV4_CONFIG_HPP
+
+#include "constants.hpp"
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Default configuration of a stack instance. Every table, queue and 
+/// buffer of the stack is sized from the configuration at compile time, 
+/// and protocols disabled are removed from the code. A custom 
+/// configuration derives from default_config and hides the members it 
+/// changes, e.g.
+///
+///   struct mcu_config : default_config
+///   {
+///     static constexpr std::size_t  interface_table_size  = 1;
+///     static constexpr std::size_t  arp_table_size        = 8;
+///     static constexpr bool         icmp_enabled          = false;
+///   };
+///
+/// Reassembly of 8 KB datagrams on a host, e.g.
+///
+///   struct host_config : default_config
+///   {
+///     static constexpr std::size_t  frame_pool_size       = 65536U;
+///     static constexpr std::size_t  reassembly_table_size = 4;
+///     static constexpr std::size_t  reassembly_max_size   = 8200U;
+///   };
+struct default_config
+{
+  static constexpr std::size_t interface_table_size     = 4;
+  static constexpr std::size_t udp_ports_table_size     = 8;
+  /// datagrams received and not read per port
+  static constexpr std::size_t port_rx_queue_size       = 2;
+  /// largest IP packet of an interface, e.g. 9000 for jumbo frames. 
+  /// Frame buffers are sized for it, and the MTU of each interface can be
+  /// set up to it at run time
+  static constexpr std::size_t max_mtu                  = 1500;
+  static constexpr std::size_t rx_burst_size            = 4;    // frames per interface per step
+  static constexpr std::size_t tx_queue_size            = 8;    // frames per interface per write
+  static constexpr std::size_t arp_table_size           = 64;   // power of two
+  static constexpr std::size_t arp_probe_limit          = 8;
+  static constexpr uint32_t    arp_entry_lifetime       = 60000; // in steps
+  static constexpr uint32_t    arp_incomplete_lifetime  = 1000;  // in steps
+  static constexpr std::size_t arp_pending_table_size   = 4;     // outstanding requests
+  static constexpr std::size_t arp_hold_queue_size      = 4;
+  static constexpr uint32_t    arp_retry_timeout        = 50;    // in steps, doubled per retry
+  static constexpr uint8_t     arp_max_retries          = 3;
+  /// buffer shared by all interfaces for the frames received, the 
+  /// datagrams sent and the ARP and ICMP frames. It is enlarged to hold a 
+  /// burst of frames of max_mtu and one more if needed. A datagram sent 
+  /// takes one block of the pool: its payload and UDP header, 34 bytes of
+  /// Ethernet and IP headers per fragment, and the 4 byte block header, 
+  /// rounded up to 16 bytes. The fragments shall also fit in the TX queue
+  /// together. With the defaults the pool is the limit, the largest UDP 
+  /// payload sent is 7976 bytes, in six fragments
+  static constexpr std::size_t frame_pool_size          = 8192U;
+  /// buffer descriptors of each direction of an interface
+  static constexpr std::size_t buffer_descriptor_size   = 4U;
+  /// datagrams reassembled from fragments at the same time per interface,
+  /// power of two. Zero disables reassembly, fragments are dropped
+  static constexpr std::size_t reassembly_table_size    = 0;
+  /// largest datagram reassembled, including the UDP header. This much of
+  /// the frame pool is held from the first fragment of a datagram
+  /// until it is complete
+  static constexpr std::size_t reassembly_max_size      = 8192U;
+  /// ranges of a datagram missing at the same time, fragments arriving 
+  /// out of order split the ranges
+  static constexpr std::size_t reassembly_hole_limit    = 4;
+  static constexpr uint32_t    reassembly_timeout       = 1000;  // in steps
+  /// alignment of the parts of an interface accessed separately, e.g. 
+  /// the word size on a target without data cache
+  static constexpr std::size_t cache_line_size          = 64;
+  /// echo requests are answered
+  static constexpr bool        icmp_enabled             = true;
+  /// ICMP messages are dropped unless their checksum matches. This sums 
+  /// the whole message, so the cost of an echo reply grows with its size.
+  /// Otherwise the checksum of a reply is derived from the request's, and
+  /// a corrupted request gets a reply that fails its checksum as well
+  static constexpr bool        icmp_checksum_enabled    = false;
+  /// ARP requests for the address of the interface are answered. Replies
+  /// are learned regardless
+  static constexpr bool        arp_reply_enabled        = true;
+  /// UDP checksums are formed on transmission and verified on reception.
+  /// Otherwise datagrams are sent without a checksum, i.e. zero
+  static constexpr bool        udp_checksum_enabled     = true;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_CONFIG_HPP
+#endif 
@@ -44,13 +44,7 @@ constexpr uint8_t   TCP  = 0x06;
 constexpr uint8_t   UDP  = 0x11;
 
 constexpr std::size_t c_min_eth_frame_size      = 60;   // without crc
-constexpr std::size_t c_max_eth_frame_size      = 1518; // without crc
-constexpr std::size_t c_interface_table_size    = 1;
-constexpr std::size_t c_arp_table_size          = 4;
-constexpr std::size_t c_udp_ports_table_size    = 8;
-constexpr std::size_t c_rx_buffer_size          = 2048U;
-constexpr std::size_t c_tx_buffer_size          = 2048U;
-constexpr std::size_t c_buffer_descriptor_size  = 4U;
+constexpr std::size_t c_min_mtu                 = 68;   // RFC 791
 
 } // namespace ipv4
 
@@ -0,0 +1,167 @@
+/// \file endian.hpp
+/// Network byte order wire field types
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+#ifndef PROTOCOL_IPV4_ENDIAN_HPP
+#define PROTOCOL_IPV4_ENDIAN_HPP
+
+#include <cstdint>
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+constexpr bool c_host_big_endian = true;
+#else
+constexpr bool c_host_big_endian = false;
+#endif
+
+/// Compilers recognize the portable forms as well, the builtins only 
+/// save the pattern matching
+constexpr uint16_t
+byte_swap
+(
+  const uint16_t  value
+)
+{
+#if defined(__GNUC__)
+  return __builtin_bswap16(value);
+#else
+  return uint16_t((value << 8) | (value >> 8));
+#endif
+}
+
+constexpr uint32_t
+byte_swap
+(
+  const uint32_t  value
+)
+{
+#if defined(__GNUC__)
+  return __builtin_bswap32(value);
+#else
+  return  ((value & 0x000000FFU) << 24) |
+          ((value & 0x0000FF00U) << 8)  |
+          ((value & 0x00FF0000U) >> 8)  |
+          ((value & 0xFF000000U) >> 24);
+#endif
+}
+
+/// Converts between host and network byte order, in either direction
+template<typename T>
+constexpr T
+network_order
+(
+  const T         value
+)
+{
+  return c_host_big_endian ? value : byte_swap(value);
+}
+
+/// Field in network byte order. The value is converted only where the 
+/// field is read or written, and a constant is converted at compile time.
+/// Fields are compared in network byte order without conversion. The 
+/// type is trivial, so headers built on it overlay the frame.
+template<typename T>
+class big_endian
+{
+public: // Methods
+
+  big_endian() = default;
+
+  constexpr explicit
+  big_endian
+  (
+    const T       value
+  )
+  : raw_(network_order(value))
+  {}
+
+  /// Field of the bytes as they are on the wire
+  static constexpr big_endian
+  from_raw
+  (
+    const T       raw
+  )
+  {
+    big_endian result{};
+    result.raw_ = raw;
+    return result;
+  }
+
+  /// Value in host byte order
+  constexpr T
+  value() const
+  {
+    return network_order(raw_);
+  }
+
+  /// Bytes as they are on the wire, e.g. to be summed
+  constexpr T
+  raw() const
+  {
+    return raw_;
+  }
+
+  constexpr bool 
+  operator==
+  (
+    const big_endian& other
+  ) const
+  {
+    return raw_ == other.raw_;
+  }
+
+  constexpr bool 
+  operator!=
+  (
+    const big_endian& other
+  ) const
+  {
+    return raw_ != other.raw_;
+  }
+
+private: // Members
+
+  T   raw_;
+};
+
+typedef big_endian<uint16_t>  be16;
+typedef big_endian<uint32_t>  be32;
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_ENDIAN_HPP
+#endif
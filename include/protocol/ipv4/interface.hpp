@@ -0,0 +1,1147 @@
+/// \file interface.hpp
+/// Per interface frame handling of the IPV4 stack: TX queue, ARP 
+/// resolution, ICMP echo and UDP framing
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+#ifndef PROTOCOL_IPV4_INTERFACE_HPP
+#define PROTOCOL_IPV4_INTERFACE_HPP
+
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "checksum.hpp"
+#include "types.hpp"
+#include "defs.hpp"
+#include "bd.hpp"
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+inline uint16_t calculate_checksum(uint16_t *ptr, unsigned size)
+{
+  return ~checksum_fold(checksum_add(0U, ptr, size));
+}
+
+/// Queues a control frame of size bytes, its block is allocated from the 
+/// frame pool and returned once the frame is written. Returns the frame to
+/// be formed, nullptr if the TX queue or the pool is full
+template<typename Config>
+uint8_t*
+queue_control_frame
+(
+  interface<Config>&  i,
+  const std::size_t   size
+)
+{
+  uint8_t *result = nullptr;
+  
+  if (i.tx_frame_count < i.tx_frames.size())
+  {
+    result = i.pool->allocate(size);
+  }
+
+  if (result != nullptr)
+  {
+    i.tx_frames[i.tx_frame_count]     = frame{ result, size, size, frame_flags_t() };
+    i.tx_frame_bds[i.tx_frame_count]  = buffer_descriptor_ref<Config>();
+    i.tx_control_frames.set(i.tx_frame_count);
+    i.tx_frame_count++;
+  }
+  else
+  {
+    TRACE(__FUNCTION__ << ": TX queue full, frame dropped\n");
+    i.statistics.tx_drops++;
+  }
+  
+  return result;
+}
+
+/// Data of a datagram carried by each of its fragments but the last, i.e.
+/// the largest multiple of 8 bytes fitting in a packet of mtu bytes
+constexpr std::size_t
+fragment_data_size
+(
+  const std::size_t mtu
+)
+{
+  return ((mtu - sizeof(ip_packet)) / 8) * 8;
+}
+
+/// Number of frames a UDP payload of size bytes is sent in
+constexpr std::size_t
+fragment_count
+(
+  const std::size_t mtu,
+  const std::size_t size
+)
+{
+  return 
+    (sizeof(ip_packet) + sizeof(udp_packet) + size <= mtu) ? 
+      1 : 
+      (sizeof(udp_packet) + size + fragment_data_size(mtu) - 1) / fragment_data_size(mtu);
+}
+
+/// The fragments of a datagram are laid out back to back in its transmit 
+/// descriptor, each after the room for its headers, so that every frame 
+/// is formed in place. Returns the size of the descriptor for a UDP 
+/// payload of size bytes, which is c_udp_headroom + size unless the 
+/// datagram is fragmented
+constexpr std::size_t
+fragmented_size
+(
+  const std::size_t mtu,
+  const std::size_t size
+)
+{
+  return fragment_count(mtu, size) * c_fragment_headroom + sizeof(udp_packet) + size;
+}
+
+/// Returns the place of the byte of the datagram at offset, counted from 
+/// the UDP header, in the descriptor
+template<typename Config>
+uint8_t*
+datagram_at
+(
+  buffer_descriptor<Config>&  bd,
+  const std::size_t           offset
+)
+{
+  const std::size_t k = (bd.fragments > 1) ? offset / bd.fragment_size : 0;
+  
+  return bd.first + (k + 1) * c_fragment_headroom + offset;
+}
+
+/// The MAC inserts the UDP checksum of the descriptor. The checksum of a 
+/// fragmented datagram spans frames, so it is always formed by the stack
+template<typename Config>
+bool
+is_l4_checksum_offloaded
+(
+  const interface<Config>&          i,
+  const buffer_descriptor<Config>&  bd
+)
+{
+  return i.offload.template test<offload_tx_l4>() && (bd.fragments == 1);
+}
+
+/// Copies the Ethernet and IP headers formed in the first frame of a 
+/// fragmented datagram to the other frames, and sets the length and the 
+/// fragment offset of each
+template<typename Config>
+void
+write_fragment_headers
+(
+  interface<Config>&          i,
+  buffer_descriptor<Config>&  bd
+)
+{
+  const std::size_t     data_size   = bd.fragment_size;
+  const std::size_t     length      = sizeof(udp_packet) + bd.size;
+  
+  for (std::size_t k = 0; k < bd.fragments; k++)
+  {
+    uint8_t           *ptr    = bd.first + k * (c_fragment_headroom + data_size);
+    ip_packet         *ip     = (ip_packet*) (ptr + sizeof(eth_packet_header));
+    const std::size_t offset  = k * data_size;
+    const bool        f_more  = (k + 1 < bd.fragments);
+    
+    if (k > 0)
+    {
+      std::memcpy(ptr, bd.first, c_fragment_headroom);
+    }
+
+    ip->total_length          = be16(sizeof(ip_packet) + std::min(data_size, length - offset));
+    ip->flags_fragment_offset = be16((f_more ? c_ip_flag_more_fragments : 0) | (offset / 8));
+    ip->checksum              = 0;
+
+    if (!i.offload.template test<offload_tx_ip>())
+    {
+      ip->checksum            = calculate_checksum( (uint16_t *) ip, 20);
+    }
+  }
+}
+
+/// Queues the frame formed in place of the descriptor for transmission. 
+/// The fragments of a fragmented datagram are formed from the first frame
+/// and queued together, so that they are written in a single call. The 
+/// descriptor is referred by its last frame, and it is released after the 
+/// last frame is written. Returns false if the TX queue is full
+template<typename Config>
+bool
+queue_frame
+(
+  interface<Config>&          i,
+  buffer_descriptor<Config>&  bd,
+  const std::size_t           size
+)
+{
+  bool result = false;
+  
+  if (i.tx_frame_count + bd.fragments <= i.tx_frames.size())
+  {
+    if (bd.fragments > 1)
+    {
+      const std::size_t     data_size   = bd.fragment_size;
+      const std::size_t     length      = sizeof(udp_packet) + bd.size;
+      
+      write_fragment_headers(i, bd);
+      
+      for (std::size_t k = 0; k < bd.fragments; k++)
+      {
+        uint8_t           *ptr    = bd.first + k * (c_fragment_headroom + data_size);
+        const std::size_t offset  = k * data_size;
+        
+        i.tx_frames[i.tx_frame_count]     = 
+          frame
+          { 
+            ptr, 
+            std::min(c_fragment_headroom + data_size, std::size_t(bd.last - ptr)), 
+            c_fragment_headroom + std::min(data_size, length - offset),
+            frame_flags_t()
+          };
+        i.tx_frame_bds[i.tx_frame_count]  = buffer_descriptor_ref<Config>();
+        i.tx_frame_count++;
+      }
+
+      i.tx_frame_bds[i.tx_frame_count - 1] = bd;
+    }
+    else
+    {
+      i.tx_frames[i.tx_frame_count]     = frame{ bd.first, std::size_t(bd.last - bd.first), size, frame_flags_t() };
+      i.tx_frame_bds[i.tx_frame_count]  = bd;
+      i.tx_frame_count++;
+    }
+    
+    // Queued descriptors are not formed again
+    clear_flags<transmit>(bd);
+    result = true;
+  }
+  
+  return result;
+}
+
+/// Removes the first n frames of the TX queue after they are written, and 
+/// releases their buffers
+template<typename Config>
+void
+release_tx_frames
+(
+  interface<Config>&  i,
+  std::size_t         n
+)
+{
+  n = std::min(n, i.tx_frame_count);
+  
+  for (std::size_t k = 0; k < n; k++)
+  {
+    if (i.tx_frame_bds[k])
+    {
+      release_bd(i.tx_frame_bds[k]->get());
+    }
+    else if (i.tx_control_frames.test(k))
+    {
+      i.pool->release(i.tx_frames[k].data);
+    }
+  }
+  
+  // Frames not written are kept in order
+  for (std::size_t k = n; k < i.tx_frame_count; k++)
+  {
+    i.tx_frames[k - n]    = i.tx_frames[k];
+    i.tx_frame_bds[k - n] = i.tx_frame_bds[k];
+  }
+  
+  i.tx_control_frames >>= n;
+  i.tx_frame_count     -= n;
+}
+
+/// Queues an ARP request or response. Returns false if the TX queue is full
+template<typename Config>
+bool
+write_arp_packet
+(
+  interface<Config>&  i,
+  arp_table_entry&    e,
+  const bool          is_response
+)
+{
+  uint8_t           *ptr  = queue_control_frame(i, sizeof(eth_packet_header) + sizeof(arp_packet));
+  
+  if (ptr == nullptr)
+  {
+    return false;
+  }
+  
+  eth_packet_header *eth  = (eth_packet_header*) ptr;
+  arp_packet        *arp  = (arp_packet*) (ptr + sizeof(eth_packet_header));
+
+  eth->dest_hw_addr       = e.hw_addr;
+  eth->source_hw_addr     = i.hw_addr;
+  eth->type               = c_ether_type_arp;
+  
+  arp->htype              = c_arp_htype_ethernet;
+  arp->ptype              = c_ether_type_ipv4;
+  arp->hlen               = 6;
+  arp->plen               = 4;
+  arp->opcode             = (is_response) ? c_arp_opcode_reply : c_arp_opcode_request;
+  
+  arp->sender_hw_addr     = i.hw_addr;
+  arp->sender_ip_addr     = i.ip_addr;
+  arp->target_hw_addr     = e.hw_addr;
+  arp->target_ip_addr     = e.ip_addr;
+  
+  TRACE(__FUNCTION__ << "\n");
+  
+  TRACE(((is_response) ? "Reply\n" : "Request\n"));
+  TRACE("Sender HW Addr : " << i.hw_addr << "\n");
+  TRACE("Sender IP Addr : " << i.ip_addr << "\n");
+  TRACE("Target HW Addr : " << e.hw_addr << "\n");
+  TRACE("Target IP Addr : " << e.ip_addr << "\n");
+  
+  return true;
+}
+
+template<typename Config>
+void 
+write_icmp_echo_packet
+(
+  interface<Config>&      i,
+  const packet_metadata&  m,
+  const uint16_t          identification
+)
+{
+  const eth_packet_header *in_eth_ptr   = m.header<eth_packet_header>(0);
+  const ip_packet         *in_ip_ptr    = m.header<ip_packet>(m.l3_offset);
+  const icmp_packet       *in_icmp_ptr  = m.header<icmp_packet>(m.l4_offset);
+  std::size_t             echo_size     = m.payload_size;
+  std::size_t         size      = sizeof(ip_packet) + 
+                                  sizeof(eth_packet_header) + 
+                                  sizeof(icmp_packet) +
+                                  echo_size;
+                    
+  TRACE(__FUNCTION__ << ":" <<  size << "\n");
+  
+  unsigned char       *ptr  = queue_control_frame(i, size);
+
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  
+  eth_packet_header   *eth  = (eth_packet_header*) ptr;
+  ip_packet           *ip   = (ip_packet*) (ptr + sizeof(eth_packet_header));
+  icmp_packet         *icmp = (icmp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
+  uint8_t             *echo = (uint8_t*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header) + sizeof(icmp_packet));
+
+  eth->dest_hw_addr         = in_eth_ptr->source_hw_addr;
+  eth->source_hw_addr       = i.hw_addr;
+
+  eth->type                 = c_ether_type_ipv4;
+  ip->version_length        = 0x45;
+  ip->diff_serv             = 0;
+  ip->total_length          = be16(size - sizeof(eth_packet_header));
+  ip->identification        = be16(identification);
+  ip->flags_fragment_offset = c_ip_no_fragment;
+  ip->protocol              = ICMP;
+  ip->ttl                   = 0x80;
+  ip->src_ip                = i.ip_addr;
+  ip->dest_ip               = in_ip_ptr->src_ip;
+  ip->checksum              = 0;
+
+  if (!i.offload.template test<offload_tx_ip>())
+  {
+    ip->checksum            = calculate_checksum( (uint16_t *) ip, 20);
+  }
+
+  icmp->type                = 0;
+  icmp->code                = 0;
+  icmp->identifier          = in_icmp_ptr->identifier;
+  icmp->sequence_number     = in_icmp_ptr->sequence_number;
+
+  std::memcpy(echo, m.frame + m.payload_offset, echo_size);
+  
+  // The reply differs from the request only in type and code, so the 
+  // checksum of the request is adjusted instead of summing the echo data
+  if (i.offload.template test<offload_tx_l4>())
+  {
+    icmp->checksum          = 0;
+  }
+  else
+  {
+    icmp->checksum          = checksum_update(in_icmp_ptr->checksum, &in_icmp_ptr->type, &icmp->type, 2);
+  }
+
+  TRACE("IP Checksum :"   <<  std::hex << ip->checksum << std::dec << ", size:20\n");  
+  TRACE("ICMP Checksum :" <<  std::hex << icmp->checksum  << std::dec << ", size:" << sizeof(icmp_packet) + echo_size << "\n");  
+}
+
+template<typename Config>
+arp_table_entry_ref
+find_arp_entry
+(
+  interface<Config>&  i,
+  const address&      a
+)
+{
+  return i.arp_table.find(a);
+}
+
+/// Returns true if a is on the subnet of the interface
+template<typename Config>
+bool
+is_on_subnet
+(
+  const interface<Config>&  i,
+  const address&            a
+)
+{
+  bool result = true;
+  
+  for (std::size_t k = 0; k < a.size(); k++)
+  {
+    result = result && ((a[k] & i.netmask[k]) == (i.ip_addr[k] & i.netmask[k]));
+  }
+  
+  return result;
+}
+
+template<typename Config>
+arp_resolution_ref<Config>
+find_arp_resolution
+(
+  interface<Config>&  i,
+  const address&      a
+)
+{
+  arp_resolution_ref<Config>  result;
+  
+  auto it = std::find_if
+  (
+    std::begin(i.arp_resolutions), 
+    std::end(i.arp_resolutions),
+    [a](auto &r) -> bool
+    {
+      return r.is_active() && r.next_hop == a;
+    }
+  );
+
+  if (it != std::end(i.arp_resolutions))
+  {
+    result = (*it);
+  }
+  
+  return result;
+}
+
+template<typename Config>
+void
+request_arp_resolution
+(
+  interface<Config>&       i,
+  arp_resolution<Config>&  r
+)
+{
+  // (Re)creating the incomplete entry also resets its age
+  auto e_ref = 
+    i.arp_table.update
+    (
+      {0xFF, 0xFF, 0XFF, 0xFF, 0xFF, 0XFF},
+      r.next_hop,
+      false
+    );
+
+  if (e_ref && write_arp_packet(i, *e_ref, false))
+  {
+    i.statistics.arp_requests++;
+  }
+}
+
+/// Holds the packet until the next hop of the packet is resolved. A new 
+/// resolution writes an ARP request. Returns false if the packet is dropped
+template<typename Config>
+bool
+hold_packet
+(
+  interface<Config>&          i,
+  buffer_descriptor<Config>&  bd
+)
+{
+  bool  result  = false;
+  auto  r_ref   = find_arp_resolution(i, bd.remote.ip_addr);
+  bool  is_new  = false;
+  
+  if (!r_ref)
+  {
+    auto it = std::find_if
+    (
+      std::begin(i.arp_resolutions), 
+      std::end(i.arp_resolutions),
+      [](auto &r) -> bool
+      {
+        return !r.is_active();
+      }
+    );
+    
+    if (it != std::end(i.arp_resolutions))
+    {
+      it->next_hop  = bd.remote.ip_addr;
+      it->retries   = 0;
+      it->deadline  = i.arp_table.now() + Config::arp_retry_timeout;
+      r_ref         = (*it);
+      is_new        = true;
+    }
+  }
+  
+  if (r_ref)
+  {
+    arp_resolution<Config> &r = *r_ref;
+    
+    result = haluj::bounded::push_back(r.queue, buffer_descriptor_ref<Config>(bd));
+
+    if (result)
+    {
+      set_flags<pending>(bd);
+      
+      if (is_new)
+      {
+        request_arp_resolution(i, r);
+      }
+    }
+  }
+  
+  if (!result)
+  {
+    TRACE(__FUNCTION__ << ": ARP hold queue full, packet dropped\n");
+    release_bd(bd);
+    i.statistics.arp_hold_drops++;
+  }
+  
+  return result;
+}
+
+template<typename Config>
+bool
+retry_arp_resolution
+(
+  interface<Config>&       i,
+  arp_resolution<Config>&  r
+)
+{
+  bool result = false;
+  
+  if (r.retries < Config::arp_max_retries)
+  {
+    r.retries++;
+    // exponential backoff
+    r.deadline = i.arp_table.now() + (Config::arp_retry_timeout << r.retries);
+
+    TRACE(__FUNCTION__ << ": retry " << uint32_t(r.retries) << " for " << r.next_hop << "\n");
+
+    request_arp_resolution(i, r);
+    
+    result = true;
+  }
+  else
+  {
+    TRACE(__FUNCTION__ << ": resolution failed for " << r.next_hop << "\n");
+
+    for (auto &bd_ref : r.queue)
+    {
+      release_bd(bd_ref->get());
+    }
+
+    i.statistics.arp_resolution_drops += r.queue.size();
+    r.queue.clear();
+    i.arp_table.remove(r.next_hop);
+  }
+  
+  return result;
+}
+
+/// Retries the resolutions whose deadline has passed, and drops the held
+/// packets of the ones which failed
+template<typename Config>
+void
+service_arp_resolutions
+(
+  interface<Config>&  i
+)
+{
+  const time_point now = i.arp_table.now();
+  
+  for (auto &r : i.arp_resolutions)
+  {
+    if (r.is_active() && int32_t(now - r.deadline) >= 0)
+    {
+      retry_arp_resolution(i, r);
+    }
+  }
+}
+
+template<typename Config>
+void
+complete_arp_resolution
+(
+  interface<Config>&  i,
+  const address&      a
+)
+{
+  auto r_ref = find_arp_resolution(i, a);
+  
+  if (r_ref)
+  {
+    arp_resolution<Config> &r = *r_ref;
+
+    // Held packets become eligible for transmission all together
+    for (auto &bd_ref : r.queue)
+    {
+      clear_flags<pending>(bd_ref->get());
+    }
+    
+    r.queue.clear();
+  }
+}
+
+/// Discards the datagram being reassembled with the fragments received
+template<typename Config>
+void
+drop_reassembly
+(
+  interface<Config>&    i,
+  reassembly<Config>&   r
+)
+{
+  release_bd(r.bd_ref->get());
+  r.bd_ref.reset();
+  i.reassemblies.remove(r);
+}
+
+/// Starts the reassembly of a datagram. The descriptor of the datagram is
+/// allocated for the largest datagram accepted, as its size is not known
+/// until the last fragment arrives
+template<typename Config>
+reassembly_table_entry_ref<Config>
+start_reassembly
+(
+  interface<Config>&    i,
+  const fragment_key&   key
+)
+{
+  auto r_ref = i.reassemblies.insert(key);
+  
+  if (r_ref)
+  {
+    reassembly<Config> &r = *r_ref;
+    
+    r.bd_ref = 
+      allocate_bd
+      (
+        *i.pool, 
+        i.rx_buffer_descriptors, 
+        Config::reassembly_max_size
+      );
+    
+    if (r.bd_ref)
+    {
+      buffer_descriptor<Config> &bd = *r.bd_ref;
+      
+      bd.remote       = endpoint{ key.src_ip, 0 };
+      bd.ip_protocol  = key.protocol;
+      bd.payload_sum  = 0;
+      r.holes.reset(Config::reassembly_max_size - 1);
+      r.deadline      = i.arp_table.now() + Config::reassembly_timeout;
+      r.size          = 0;
+    }
+    else
+    {
+      i.reassemblies.remove(r);
+      r_ref.reset();
+    }
+  }
+  
+  return r_ref;
+}
+
+/// Copies the fragment to its place in the datagram it belongs to. Returns
+/// the descriptor of the datagram once all of its fragments have arrived, 
+/// the payload of the descriptor starts with the header of the transport 
+/// protocol
+template<typename Config>
+buffer_descriptor_ref<Config>
+reassemble_fragment
+(
+  interface<Config>&      i,
+  const packet_metadata&  m
+)
+{
+  buffer_descriptor_ref<Config>   result;
+  const ip_packet                 *ip     = m.header<ip_packet>(m.l3_offset);
+  const std::size_t               first   = m.fragment_offset;
+  const std::size_t               last    = first + m.payload_size - 1;
+  const fragment_key              key     = 
+    { 
+      ip->src_ip, 
+      ip->dest_ip, 
+      ip->identification, 
+      ip->protocol 
+    };
+  
+  auto r_ref = i.reassemblies.find(key);
+  
+  // Only UDP datagrams are delivered
+  if (!r_ref && (m.ip_protocol == UDP) && (last < Config::reassembly_max_size))
+  {
+    r_ref = start_reassembly(i, key);
+  }
+  
+  if (r_ref)
+  {
+    reassembly<Config>        &r      = *r_ref;
+    buffer_descriptor<Config> &bd     = *r.bd_ref;
+    fill_result               outcome = fill_result::rejected;
+    
+    if (last < Config::reassembly_max_size)
+    {
+      outcome = r.holes.fill(uint16_t(first), uint16_t(last), m.more_fragments);
+    }
+    
+    if (outcome == fill_result::filled)
+    {
+      const uint8_t *payload = m.frame + m.payload_offset;
+      
+      // Fragments start at multiples of 8 bytes, so their sums add up to 
+      // the sum of the datagram in any order of arrival
+      if (Config::udp_checksum_enabled)
+      {
+        bd.payload_sum = checksum_copy(bd.payload_sum, bd.first + first, payload, m.payload_size);
+      }
+      else
+      {
+        std::memcpy(bd.first + first, payload, m.payload_size);
+      }
+      
+      if (!m.more_fragments)
+      {
+        r.size = last + 1;
+      }
+      
+      if (r.holes.empty())
+      {
+        TRACE(__FUNCTION__ << ": datagram of " << r.size << " bytes reassembled\n");
+        
+        shrink_bd(bd, r.size);
+        
+        result = r.bd_ref;
+        r.bd_ref.reset();
+        i.reassemblies.remove(r);
+      }
+    }
+    else if (outcome == fill_result::rejected)
+    {
+      TRACE(__FUNCTION__ << ": fragment rejected, datagram dropped\n");
+      drop_reassembly(i, r);
+      i.statistics.reassembly_drops++;
+    }
+  }
+  else
+  {
+    TRACE(__FUNCTION__ << ": fragment dropped\n");
+    i.statistics.reassembly_drops++;
+  }
+  
+  return result;
+}
+
+/// Discards the datagrams whose fragments did not arrive in time
+template<typename Config>
+void
+expire_reassemblies
+(
+  interface<Config>&  i
+)
+{
+  if (i.reassemblies.size() > 0)
+  {
+    const time_point now = i.arp_table.now();
+    
+    for (auto &r : i.reassemblies)
+    {
+      if (r.is_occupied() && int32_t(now - r.deadline) >= 0)
+      {
+        TRACE(__FUNCTION__ << ": reassembly timed out\n");
+        drop_reassembly(i, r);
+        i.statistics.reassembly_timeouts++;
+      }
+    }
+  }
+}
+
+/// Forms the frame in place of the descriptor and returns its size
+template<typename Config>
+std::size_t
+write_udp_packet
+(
+  interface<Config>&          i,
+  arp_table_entry&            e, 
+  buffer_descriptor<Config>&  bd,
+  const uint16_t              identification
+)
+{
+  // Headers are written into the headroom of the descriptor, in front of 
+  // the payload
+  std::size_t len = bd.offset + bd.size;
+
+  unsigned char       *ptr      = (unsigned char*) bd.first;
+  eth_packet_header   *eth      = (eth_packet_header*) ptr;
+  ip_packet           *ip       = (ip_packet*) (ptr + sizeof(eth_packet_header));
+  udp_packet          *udp      = (udp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
+  
+  eth->dest_hw_addr         = e.hw_addr;
+  eth->source_hw_addr       = i.hw_addr;
+
+  eth->type                 = c_ether_type_ipv4;
+  ip->version_length        = 0x45;
+  ip->diff_serv             = 0;
+  ip->total_length          = be16(len - sizeof(eth_packet_header));
+  ip->identification        = be16(identification);
+  ip->flags_fragment_offset = c_ip_dont_fragment;
+  ip->protocol              = UDP;
+  ip->ttl                   = 0x80;
+  ip->src_ip                = i.ip_addr;
+  ip->dest_ip               = e.ip_addr;
+  ip->checksum              = 0;
+
+  if (!i.offload.template test<offload_tx_ip>())
+  {
+    ip->checksum            = calculate_checksum( (uint16_t *) ip, 20);
+  }
+
+  udp->src_port             = be16(bd.port);
+  udp->dest_port            = be16(bd.remote.port);
+  udp->length               = be16(sizeof(udp_packet) + bd.size);
+  udp->checksum             = 0;
+
+  // Checksum field is left zero, if the MAC inserts the checksum or UDP 
+  // checksums are disabled
+  if (Config::udp_checksum_enabled && !is_l4_checksum_offloaded(i, bd))
+  {
+    checksum    udp_checksum;
+    // psuedo header 
+    udp_checksum.append(&ip->src_ip, sizeof(ip->src_ip));
+    udp_checksum.append(&ip->dest_ip, sizeof(ip->src_ip));
+    udp_checksum.append(be16(UDP));
+    udp_checksum.append(udp->length);
+    udp_checksum.append(udp, sizeof(udp_packet));
+
+    if (bd.flags.template test<summed>())
+    {
+      udp_checksum.sum += bd.payload_sum;
+    }
+    else
+    {
+      udp_checksum.append(bd.first + bd.offset, bd.size);
+    }
+
+    udp->checksum             = udp_checksum.finalize();
+
+    // Zero means no checksum, its one's complement equivalent is sent 
+    if (udp->checksum == 0)
+    {
+      udp->checksum = 0xFFFF;
+    }
+  }
+
+  TRACE(__FUNCTION__ << " UDP payload size:" << bd.size << "\n");
+  
+  return len;
+}
+
+/// Builds the header template of the flow connecting the port of the 
+/// interface designated by id to remote
+template<typename Config>
+void
+build_udp_flow
+(
+  const interface_designator  id,
+  interface<Config>&          i,
+  udp_flow&                   f,
+  const uint16_t              port,
+  const endpoint&             remote
+)
+{
+  uint8_t             *ptr      = f.header.data();
+  eth_packet_header   *eth      = (eth_packet_header*) ptr;
+  ip_packet           *ip       = (ip_packet*) (ptr + sizeof(eth_packet_header));
+  udp_packet          *udp      = (udp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
+
+  // Destination hardware address is filled when the flow is resolved
+  eth->dest_hw_addr         = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  eth->source_hw_addr       = i.hw_addr;
+
+  eth->type                 = c_ether_type_ipv4;
+  ip->version_length        = 0x45;
+  ip->diff_serv             = 0;
+  ip->total_length          = be16(0);
+  ip->identification        = be16(0);
+  ip->flags_fragment_offset = c_ip_dont_fragment;
+  ip->protocol              = UDP;
+  ip->ttl                   = 0x80;
+  ip->src_ip                = i.ip_addr;
+  ip->dest_ip               = remote.ip_addr;
+  ip->checksum              = 0;
+
+  udp->src_port             = be16(port);
+  udp->dest_port            = be16(remote.port);
+  udp->length               = be16(0);
+  udp->checksum             = 0;
+
+  checksum    ip_checksum;
+  ip_checksum.append(ip, sizeof(ip_packet));
+
+  checksum    udp_checksum;
+  // psuedo header without length
+  udp_checksum.append(&ip->src_ip, sizeof(ip->src_ip));
+  udp_checksum.append(&ip->dest_ip, sizeof(ip->dest_ip));
+  udp_checksum.append(be16(UDP));
+  udp_checksum.append(udp, sizeof(udp_packet));
+
+  f.remote      = remote;
+  f.intf        = id;
+  f.port        = port;
+  f.ip_sum      = ip_checksum.sum;
+  f.udp_sum     = udp_checksum.sum;
+  f.resolved    = false;
+  f.connected   = true;
+}
+
+/// Returns true if the descriptor is sent through a connected flow whose 
+/// destination hardware address is resolved. The ARP table is looked up 
+/// only if it changed since the flow was resolved
+template<typename Config>
+bool
+resolve_udp_flow
+(
+  interface<Config>&          i,
+  buffer_descriptor<Config>&  bd
+)
+{
+  bool result = false;
+  
+  if (bd.flow_ref && bd.flow_ref->get().is_connected())
+  {
+    udp_flow &f = *bd.flow_ref;
+    
+    // The flow may be connected to another remote, or the port bound 
+    // again, since the descriptor is committed
+    if 
+    (
+      (f.port == bd.port) &&
+      (f.remote.ip_addr == bd.remote.ip_addr) && 
+      (f.remote.port == bd.remote.port)
+    )
+    {
+      result = 
+        f.resolved && 
+        (f.arp_generation == i.arp_table.generation()) &&
+        (i.arp_table.now() - f.arp_updated < i.arp_table.lifetime());
+
+      if (!result)
+      {
+        auto e_ref = find_arp_entry(i, f.remote.ip_addr);
+        
+        if (e_ref && e_ref->get().is_complete())
+        {
+          arp_table_entry   &e    = *e_ref;
+          eth_packet_header *eth  = (eth_packet_header*) f.header.data();
+          
+          eth->dest_hw_addr = e.hw_addr;
+          f.arp_generation  = i.arp_table.generation();
+          f.arp_updated     = e.elapsed;
+          f.resolved        = true;
+          result            = true;
+        }
+        else
+        {
+          f.resolved        = false;
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+/// Forms the frame in place of the descriptor from the header template
+/// of the flow and returns its size
+template<typename Config>
+std::size_t
+write_connected_udp_packet
+(
+  interface<Config>&          i,
+  udp_flow&                   f,
+  buffer_descriptor<Config>&  bd,
+  const uint16_t              identification
+)
+{
+  std::size_t len = bd.offset + bd.size;
+
+  unsigned char       *ptr      = (unsigned char*) bd.first;
+  ip_packet           *ip       = (ip_packet*) (ptr + sizeof(eth_packet_header));
+  udp_packet          *udp      = (udp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
+
+  std::memcpy(ptr, f.header.data(), f.header.size());
+
+  ip->total_length          = be16(len - sizeof(eth_packet_header));
+  ip->identification        = be16(identification);
+
+  if (!i.offload.template test<offload_tx_ip>())
+  {
+    checksum  ip_checksum{ f.ip_sum };
+    ip_checksum.append(ip->total_length);
+    ip_checksum.append(ip->identification);
+    ip->checksum            = ip_checksum.finalize();
+  }
+
+  udp->length               = be16(sizeof(udp_packet) + bd.size);
+
+  if (Config::udp_checksum_enabled && !is_l4_checksum_offloaded(i, bd))
+  {
+    // Length is both in the pseudo header and the UDP header
+    checksum  udp_checksum{ f.udp_sum };
+    udp_checksum.append(udp->length);
+    udp_checksum.append(udp->length);
+
+    if (bd.flags.template test<summed>())
+    {
+      udp_checksum.sum += bd.payload_sum;
+    }
+    else
+    {
+      udp_checksum.append(bd.first + bd.offset, bd.size);
+    }
+
+    udp->checksum           = udp_checksum.finalize();
+
+    if (udp->checksum == 0)
+    {
+      udp->checksum = 0xFFFF;
+    }
+  }
+
+  TRACE(__FUNCTION__ << " UDP payload size:" << bd.size << "\n");
+  
+  return len;
+}
+
+template<typename Config>
+void
+process_arp_packet
+(
+  interface<Config>&      i,
+  const packet_metadata&  m
+)
+{
+  const arp_packet  *arp    = m.header<arp_packet>(m.l3_offset);
+  const be16        opcode  = arp->opcode;
+  
+  TRACE(__FUNCTION__ << "\n");
+  TRACE("Target IP (" << arp->target_ip_addr << ") == My IP(" << i.ip_addr << ")\n");
+
+  if (// opcode == c_arp_opcode_request &&
+      arp->htype  == c_arp_htype_ethernet &&
+      arp->ptype  == c_ether_type_ipv4 &&
+      arp->hlen   == 6 &&
+      arp->plen   == 4 &&
+      arp->target_ip_addr == i.ip_addr)
+  {
+    // Creates the entry or updates the existing one, which also completes
+    // a pending resolution and resets the age of the entry
+    auto e_ref = 
+      i.arp_table.update
+      (
+        arp->sender_hw_addr,
+        arp->sender_ip_addr,
+        true
+      );
+
+    complete_arp_resolution(i, arp->sender_ip_addr);
+    
+    if (Config::arp_reply_enabled && (opcode == c_arp_opcode_request) && e_ref)
+    {
+      // is request
+      arp_table_entry &e = *e_ref;
+      // write response 
+      write_arp_packet(i, e, true);
+    }
+  }
+}
+
+template<typename Config>
+void 
+process_icmp_packet
+(
+  interface<Config>&      i,
+  const packet_metadata&  m,
+  std::size_t&            identification
+)
+{
+  const icmp_packet *icmp_ptr = m.header<icmp_packet>(m.l4_offset);
+  bool              f_valid   = true;
+
+  if (Config::icmp_checksum_enabled && !m.checksum_verified)
+  {
+    checksum icmp_checksum;
+
+    icmp_checksum.append(icmp_ptr, sizeof(icmp_packet) + m.payload_size);
+    f_valid = (icmp_checksum.finalize() == 0);
+  }
+
+  if (!f_valid)
+  {
+    TRACE(__FUNCTION__ << " : ICMP checksum error\n");
+    i.statistics.icmp_checksum_errors++;
+  }
+  else if (icmp_ptr->type == 0x08)
+  {
+    TRACE("ICMP Checksum :" << std::hex << icmp_ptr->checksum << std::dec << "\n");  
+    write_icmp_echo_packet( i, m, identification++ );
+  }
+}
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_INTERFACE_HPP
+#endif
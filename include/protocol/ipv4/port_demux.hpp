@@ -0,0 +1,243 @@
+/// \file port_demux.hpp
+/// Constant time demultiplexing of ports
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+
+#ifndef PROTOCOL_IPV4_PORT_DEMUX_HPP
+#define PROTOCOL_IPV4_PORT_DEMUX_HPP
+
+#include <cstdint>
+#include <array>
+#include <optional>
+#include <limits>
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Maps (interface, port) pairs to port table indexes. The map is an open
+/// addressing hash table with linear probing, kept at most half full so the
+/// expected probe count is constant for sparse and dense port sets alike. 
+/// Removal shifts the following entries back, so no tombstones accumulate
+/// with repeated bind and unbind.
+template
+<
+  std::size_t Size
+>
+class port_demux
+{
+public: // Types
+
+  typedef std::size_t   designator;
+
+  static constexpr designator c_any = std::numeric_limits<designator>::max();
+
+private: // Types
+
+  static constexpr std::size_t ceil2(const std::size_t n)
+  {
+    std::size_t result = 1;
+    
+    while (result < n)
+    {
+      result <<= 1;
+    }
+    
+    return result;
+  }
+
+  static constexpr std::size_t c_capacity = ceil2(2 * Size);
+  
+  static constexpr uint16_t    c_empty    = std::numeric_limits<uint16_t>::max();
+  
+  struct entry
+  {
+    designator  id;
+    uint16_t    port;
+    uint16_t    index   = c_empty;
+  };
+
+  static_assert(Size < c_empty, "Size exceeds the index range");
+
+public: // Constructors and Destructor
+
+  port_demux()
+  {}
+
+public: // Methods
+
+  /// Returns the index of the port bound to the interface id exactly
+  std::optional<std::size_t>
+  find_exact
+  (
+    const designator  id,
+    const uint16_t    port
+  ) const
+  {
+    std::optional<std::size_t>  result;
+    
+    for (std::size_t k = home(id, port); entries_[k].index != c_empty; k = next(k))
+    {
+      const entry &e = entries_[k];
+      
+      if (e.port == port && e.id == id)
+      {
+        result = e.index;
+        break;
+      }
+    }
+    
+    return result;
+  }
+
+  /// Returns the index of the port bound to the interface id, or of the 
+  /// same port bound to all interfaces
+  std::optional<std::size_t>
+  find
+  (
+    const designator  id,
+    const uint16_t    port
+  ) const
+  {
+    auto result = find_exact(id, port);
+    
+    if (!result)
+    {
+      result = find_exact(c_any, port);
+    }
+    
+    return result;
+  }
+
+  bool
+  insert
+  (
+    const designator  id,
+    const uint16_t    port,
+    const std::size_t index
+  )
+  {
+    bool result = false;
+    
+    if (!find_exact(id, port))
+    {
+      std::size_t k = home(id, port);
+      
+      while (entries_[k].index != c_empty)
+      {
+        k = next(k);
+      }
+      
+      entries_[k] = entry{id, port, uint16_t(index)};
+      result      = true;
+    }
+    
+    return result;
+  }
+
+  void
+  remove
+  (
+    const designator  id,
+    const uint16_t    port
+  )
+  {
+    std::size_t k = home(id, port);
+
+    for (; entries_[k].index != c_empty; k = next(k))
+    {
+      if (entries_[k].port == port && entries_[k].id == id)
+      {
+        break;
+      }
+    }
+    
+    if (entries_[k].index != c_empty)
+    {
+      // backward shift of the entries displaced beyond the removed one
+      std::size_t hole = k;
+      
+      for (k = next(k); entries_[k].index != c_empty; k = next(k))
+      {
+        std::size_t h = home(entries_[k].id, entries_[k].port);
+        
+        // move entry k to the hole if its home is not in (hole, k]
+        if (((k - h) & (c_capacity - 1)) >= ((k - hole) & (c_capacity - 1)))
+        {
+          entries_[hole]  = entries_[k];
+          hole            = k;
+        }
+      }
+      
+      entries_[hole].index = c_empty;
+    }
+  }
+
+  void
+  clear()
+  {
+    for (auto &e : entries_)
+    {
+      e.index = c_empty;
+    }
+  }
+
+private: // Methods
+
+  static std::size_t home(const designator id, const uint16_t port)
+  {
+    uint32_t h = (uint32_t(port) | (uint32_t(id) << 16)) * 2654435769U;
+    
+    return h >> (32 - log2(c_capacity));
+  }
+
+  static std::size_t next(const std::size_t k)
+  {
+    return (k + 1) & (c_capacity - 1);
+  }
+
+  static constexpr unsigned log2(const std::size_t n)
+  {
+    return (n <= 1) ? 0 : 1 + log2(n >> 1);
+  }
+
+private: // Members
+
+  std::array<entry, c_capacity>   entries_;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_PORT_DEMUX_HPP
+#endif 
@@ -0,0 +1,352 @@
+/// \file reassembly.hpp
+/// Tracking of IPV4 datagrams reassembled from fragments
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+/// \author Selcuk Iyikalender
+/// \date   2022
+
+
+#ifndef PROTOCOL_IPV4_REASSEMBLY_HPP
+#define PROTOCOL_IPV4_REASSEMBLY_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <optional>
+#include <functional>
+
+#include "address.hpp"
+#include "endian.hpp"
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Fragments of a datagram share the addresses, the identification and 
+/// the protocol (RFC 791)
+struct fragment_key
+{
+  address     src_ip;
+  address     dest_ip;
+  be16        identification;
+  uint8_t     protocol;
+};
+
+inline bool 
+operator==
+(
+  const fragment_key& lhs,
+  const fragment_key& rhs
+)
+{
+  return  (lhs.src_ip == rhs.src_ip) && 
+          (lhs.dest_ip == rhs.dest_ip) && 
+          (lhs.identification == rhs.identification) && 
+          (lhs.protocol == rhs.protocol);
+}
+
+/// filled:     the fragment is placed in a hole
+/// duplicate:  the fragment is received before, it is ignored
+/// rejected:   the fragment overlaps the data received partially, conflicts 
+///             with the end of the datagram, or there are too many holes. 
+///             The datagram is discarded
+enum class fill_result
+{
+  filled,
+  duplicate,
+  rejected
+};
+
+/// Ranges of a datagram not yet received (RFC 815). The list starts with a
+/// single hole covering the largest datagram accepted, and a fragment 
+/// splits the hole it falls in to at most two. The last fragment closes 
+/// the hole reaching the end, so the datagram is complete when no hole 
+/// is left. Bounds are inclusive.
+template<std::size_t Limit>
+class hole_list
+{
+  static_assert(Limit > 0, "Limit shall not be zero");
+
+  struct hole
+  {
+    uint16_t  first;
+    uint16_t  last;
+  };
+
+public: // Methods
+
+  void
+  reset
+  (
+    const uint16_t  last
+  )
+  {
+    holes_[0] = hole{ 0, last };
+    count_    = 1;
+    end_      = last;
+  }
+
+  fill_result
+  fill
+  (
+    const uint16_t  first,
+    const uint16_t  last,
+    const bool      f_more_fragments
+  )
+  {
+    fill_result result  = fill_result::duplicate;
+    std::size_t k       = 0;
+    
+    for (; k < count_; k++)
+    {
+      if ((first <= holes_[k].last) && (last >= holes_[k].first))
+      {
+        break;
+      }
+    }
+
+    if (k < count_)
+    {
+      const hole  h       = holes_[k];
+      // the last fragment ends the hole reaching the end of the datagram
+      const bool  f_head  = first > h.first;
+      const bool  f_tail  = f_more_fragments && (last < h.last);
+      
+      if 
+      (
+        (first < h.first) || 
+        (last > h.last) ||
+        (!f_more_fragments && (h.last != end_)) ||
+        (f_more_fragments && (last >= end_)) ||
+        (f_head && f_tail && (count_ == Limit))
+      )
+      {
+        result = fill_result::rejected;
+      }
+      else
+      {
+        remove(k);
+        
+        if (f_head)
+        {
+          holes_[count_++] = hole{ h.first, uint16_t(first - 1) };
+        }
+        
+        if (f_tail)
+        {
+          holes_[count_++] = hole{ uint16_t(last + 1), h.last };
+        }
+        
+        result = fill_result::filled;
+      }
+    }
+    
+    return result;
+  }
+
+  bool
+  empty() const
+  {
+    return count_ == 0;
+  }
+
+private: // Methods
+
+  void
+  remove
+  (
+    const std::size_t k
+  )
+  {
+    holes_[k] = holes_[--count_];
+  }
+
+private: // Members
+
+  std::array<hole, Limit>   holes_;
+  std::size_t               count_  = 0;
+  /// last byte of the largest datagram accepted
+  uint16_t                  end_    = 0;
+};
+
+/// Fixed capacity open addressing table of the datagrams being 
+/// reassembled, keyed on the fragment key. The table is small, so a key is
+/// probed over all slots from its home slot. A new datagram is refused when
+/// the table is full, the ones being reassembled are completed or expire.
+/// Entry provides key, is_occupied(), set_occupied() and clear_occupied().
+template
+<
+  typename    Entry,
+  std::size_t Size
+>
+class reassembly_table
+{
+  static_assert((Size & (Size - 1)) == 0, "Size shall be a power of two");
+
+public: // Types
+
+  typedef Entry                                         entry;
+  typedef std::optional<std::reference_wrapper<Entry>>  entry_ref;
+  
+public: // Methods
+
+  entry_ref
+  find
+  (
+    const fragment_key& key
+  )
+  {
+    entry_ref result;
+    
+    if (count_ > 0)
+    {
+      std::size_t index = home(key);
+
+      for (std::size_t n = 0; n < Size; n++, index = next(index))
+      {
+        entry &e = entries_[index];
+
+        if (e.is_occupied() && e.key == key)
+        {
+          result = e;
+          break;
+        }
+      }
+    }
+    
+    return result;
+  }
+
+  /// Occupies a free entry for the key, which shall not be in the table. 
+  /// Returns an empty reference if the table is full
+  entry_ref
+  insert
+  (
+    const fragment_key& key
+  )
+  {
+    entry_ref   result;
+    std::size_t index = home(key);
+
+    for (std::size_t n = 0; n < Size; n++, index = next(index))
+    {
+      entry &e = entries_[index];
+
+      if (!e.is_occupied())
+      {
+        e.key = key;
+        e.set_occupied();
+        count_++;
+        result = e;
+        break;
+      }
+    }
+    
+    return result;
+  }
+
+  void
+  remove
+  (
+    entry&  e
+  )
+  {
+    e.clear_occupied();
+    count_--;
+  }
+
+  void
+  clear()
+  {
+    for (auto &e : entries_)
+    {
+      e.clear_occupied();
+    }
+    
+    count_ = 0;
+  }
+
+  /// Number of datagrams being reassembled
+  std::size_t
+  size() const
+  {
+    return count_;
+  }
+
+  entry* begin()
+  {
+    return entries_.data();
+  }
+
+  entry* end()
+  {
+    return entries_.data() + Size;
+  }
+
+private: // Methods
+
+  static constexpr unsigned log2(const std::size_t n)
+  {
+    return (n <= 1) ? 0 : 1 + log2(n >> 1);
+  }
+
+  static std::size_t home(const fragment_key& key)
+  {
+    // Fibonacci hashing of the fields mixed, the identification differs 
+    // the most between the datagrams of the same peers
+    uint32_t src;
+    uint32_t dest;
+    
+    std::memcpy(&src, key.src_ip.data(), sizeof(src));
+    std::memcpy(&dest, key.dest_ip.data(), sizeof(dest));
+
+    uint32_t h = 
+      (src ^ dest ^ (uint32_t(key.identification.raw()) << 8) ^ key.protocol) * 
+      2654435769U;
+    
+    return (Size > 1) ? (h >> (32 - log2(Size))) : 0;
+  }
+
+  static std::size_t next(const std::size_t index)
+  {
+    return (index + 1) & (Size - 1);
+  }
+
+private: // Members
+
+  std::array<entry, Size>   entries_;
+  std::size_t               count_ = 0;
+};
+
+} // namespace ipv4
+
+} // namespace protocol
+
+//  PROTOCOL_IPV4_REASSEMBLY_HPP
+#endif
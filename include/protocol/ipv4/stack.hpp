@@ -32,244 +32,1457 @@ For more information, please refer to <http://unlicense.org>
 #ifndef PROTOCOL_IPV4_HPP
 #define PROTOCOL_IPV4_HPP
 
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "config.hpp"
+#include "checksum.hpp"
 #include "types.hpp"
 #include "defs.hpp"
+#include "bd.hpp"
+#include "interface.hpp"
+#include "port_demux.hpp"
+
+namespace protocol
+{
+
+namespace ipv4
+{
+
+/// Validates the headers of the frame and fills the metadata in a single 
+/// pass. Returns false if the frame is malformed, longer than 
+/// max_frame_size or not supported
+extern bool
+parse_frame
+(
+  const frame&        f,
+  const std::size_t   max_frame_size,
+  packet_metadata&    m
+);
+
+/// An IPV4 stack instance. All state of the stack, i.e. interfaces, 
+/// ARP tables and UDP ports, is owned by the instance. Instances share 
+/// no mutable state, so independent instances can be run on different
+/// threads.
+template
+<
+  typename Config = default_config
+>
+class stack
+{
+public: // Types
+
+  typedef Config  config;
+
+  typedef std::array
+  <
+    interface<Config>, 
+    config::interface_table_size
+  >                                             interface_container;
+
+  typedef std::array
+  <
+    port_descriptor<Config>, 
+    config::udp_ports_table_size
+  >                                             udp_ports_table_type;
+
+  typedef port_demux
+  <
+    config::udp_ports_table_size
+  >                                             udp_demux_type;
+
+public: // Constructors and Destructor
+
+  stack()
+  : ip_identification_(0)
+  {
+    initialize();
+  }
+  
+  stack(const stack&) = delete;
+
+  stack(stack&& ) = delete;
+
+  ~stack() {}
+
+public: // Methods
+
+  /// Services every interface once per call. For each interface a burst of 
+  /// up to config::rx_burst_size frames is received and processed back to back, 
+  /// then the responses (ARP, ICMP) and the pending user packets are 
+  /// queued and written in a single call. The callbacks receive the 
+  /// designator of the interface being serviced:
+  ///   is_rx_available(id)
+  ///   read(id, frame *frames, count) reads up to count frames into the 
+  ///     buffers of frames, sets their sizes and returns the number read. 
+  ///     The buffers are blocks of the frame pool, and a received datagram
+  ///     keeps the block of its frame instead of being copied. Received 
+  ///     frames are never written by the stack, so the driver may instead
+  ///     point data at its own, e.g. DMA ring, memory which must remain 
+  ///     valid until step returns. Datagrams of such frames are copied.
+  ///     While the pool has no block left a single frame is read into a 
+  ///     reserve of the stack, and its datagrams are copied as well. 
+  ///     Frames handed over with deliver() are not read, so the interface
+  ///     is reported as not available
+  ///   write(id, const frame *frames, count) writes up to count frames in
+  ///     order and returns the number written. The rest is retried on the 
+  ///     next step
+  template
+  <
+    typename IsRxAvailableFunction,
+    typename ReadFunction,
+    typename WriteFunction
+  >
+  void 
+  step
+  (
+    IsRxAvailableFunction   is_rx_available,
+    ReadFunction            read,
+    WriteFunction           write
+  )
+  {
+    for(interface_designator id = 0; id < interfaces_.size(); id++)
+    {
+      interface<Config> &i = interfaces_[id];
+      
+      i.arp_table.tick();
+      
+      expire_reassemblies(i);
+
+      if (is_rx_available(id))
+      {
+        std::array<uint8_t*, config::rx_burst_size> blocks;
+        std::size_t                                 m = 0;
+
+        // The burst is limited by the blocks available in the pool
+        for (; m < i.rx_frames.size(); m++)
+        {
+          blocks[m] = pool_.allocate(frame_size(i.mtu));
+          
+          if (blocks[m] == nullptr)
+          {
+            break;
+          }
+          
+          i.rx_frames[m] = frame{ blocks[m], frame_size(i.mtu), 0, frame_flags_t() };
+        }
+        
+        // The pool may be held by datagrams waiting for the ARP reply 
+        // which releases them. A single frame is then read into the 
+        // reserve, whose datagrams are copied as those of driver memory
+        if (m == 0)
+        {
+          blocks[m]       = nullptr;
+          i.rx_frames[m]  = frame{ rx_reserve_.data(), frame_size(i.mtu), 0, frame_flags_t() };
+          m++;
+        }
+        
+        std::size_t n = 
+          (m > 0) ?
+            read
+            (
+              id,
+              i.rx_frames.data(), 
+              m
+            ) :
+            0;
+        
+        if (n == 0)
+        {
+          TRACE("ERROR ! Packet read\n");
+        }
+        
+        // Frames of the burst are processed back to back. Responses for 
+        // ARP and ICMP are queued, and written together with user packets.
+        // The blocks not taken over by a descriptor are returned
+        for (std::size_t k = 0; k < m; k++)
+        {
+          const frame &f = i.rx_frames[k];
+          
+          if 
+          (
+            (
+              (k >= n) || 
+              !process_received_frame(i, f, (f.data == blocks[k]) ? blocks[k] : nullptr, nullptr, true, true)
+            ) &&
+            (blocks[k] != nullptr)
+          )
+          {
+            pool_.release(blocks[k]);
+          }
+        }
+      }
+      
+      TRACE(__FUNCTION__ << ": Process user packets\n");
+
+      service_arp_resolutions(i);
+
+      // Only the descriptors ready for transmission are visited
+      i.tx_buffer_descriptors.for_each_ready
+      (
+        [&](buffer_descriptor<Config> &bd)
+        {
+          process_tx_descriptor(i, bd);
+        }
+      );
+
+      flush_tx_frames(id, i, write);
+    }
+  }
+
+  /// Processes a frame received by the driver in its own memory, e.g. a 
+  /// slot of its DMA ring, without copying it into the frame pool. If a 
+  /// release function is set for the interface, the frame is handed over:
+  /// a received datagram keeps it until the application releases the 
+  /// datagram, otherwise it is returned before deliver returns. Without a 
+  /// release function the frame is only lent for the call and datagrams 
+  /// are copied. Responses are written by the next step. Returns false if
+  /// id designates no interface, the frame is then not handed over
+  bool
+  deliver
+  (
+    const interface_designator  id,
+    const frame_handle&         h
+  )
+  {
+    bool result = false;
+    
+    if (id < interfaces_.size())
+    {
+      interface<Config> &i        = interfaces_[id];
+      const frame       f         = frame{ h.data, h.size, h.size, h.flags };
+      const bool        f_handed  = (i.frame_release != nullptr);
+      
+      if 
+      (
+        !process_received_frame(i, f, nullptr, f_handed ? &h : nullptr, true, true) && 
+        f_handed
+      )
+      {
+        i.frame_release(h);
+      }
+      
+      result = true;
+    }
+    
+    return result;
+  }
+
+  void 
+  initialize()
+  {
+    pool_.reset();
+    
+    for (auto &i : interfaces_)
+    {
+      invalidate_descriptors(i.tx_buffer_descriptors);
+      invalidate_descriptors(i.rx_buffer_descriptors);
+      i.pool = &pool_;
+      i.arp_table.clear();
+      i.reassemblies.clear();
+      i.tx_frame_count = 0;
+      i.tx_control_frames.reset();
+      
+      for (auto &r : i.arp_resolutions)
+      {
+        r.queue.clear();
+      }
+    }
+    
+    for (auto &p : udp_ports_)
+    {
+      p = port_descriptor<Config>();
+    }
+    
+    udp_demux_.clear();
+  }
+
+  /// Sets the addresses of the interface. A port bound to all interfaces 
+  /// sends to a destination not resolved yet over the interface whose 
+  /// subnet, ip_addr masked by netmask, holds it, or else over the first
+  /// interface. The default netmask holds only ip_addr.
+  bool
+  set
+  (
+    const interface_designator  id,
+    ethernet::address           hw_addr, 
+    ipv4::address               ip_addr,
+    ipv4::address               netmask = {0xFF, 0xFF, 0xFF, 0xFF}
+  )
+  {
+    bool result = false;
+
+    if (id < interfaces_.size())
+    {
+      auto &n = interfaces_[id];
+      n.hw_addr = hw_addr;
+      n.ip_addr = ip_addr;
+      n.netmask = netmask;
+
+      // Header templates of the flows carry the addresses of the interface
+      for (auto &p : udp_ports_)
+      {
+        auto &f = p.flow;
+
+        if (f.is_connected() && (f.intf == id))
+        {
+          build_udp_flow(id, n, f, p.port, f.remote);
+        }
+      }
+
+      result = true;
+    }
+   
+    return result;
+  }
+
+  /// Sets the MTU of the interface, up to config::max_mtu. Frames longer 
+  /// than the MTU are neither read nor accepted, and datagrams larger are 
+  /// fragmented. Transmit descriptors already allocated keep the MTU they 
+  /// are allocated with
+  bool
+  set_mtu
+  (
+    const interface_designator  id,
+    const std::size_t           mtu
+  )
+  {
+    bool result = false;
+
+    if (id < interfaces_.size() && mtu >= c_min_mtu && mtu <= config::max_mtu)
+    {
+      interfaces_[id].mtu = mtu;
+      result = true;
+    }
+   
+    return result;
+  }
+
+  /// Sets the function returning the frames of the interface handed over 
+  /// by deliver(), nullptr if the frames are only lent for the call
+  bool
+  set_frame_release
+  (
+    const interface_designator  id,
+    frame_release_function      release
+  )
+  {
+    bool result = false;
+
+    if (id < interfaces_.size())
+    {
+      interfaces_[id].frame_release = release;
+      result = true;
+    }
+   
+    return result;
+  }
+
+  /// Sets the checksum offload capabilities of the MAC of the interface. 
+  /// Checksums offloaded are not computed or verified by the stack
+  bool
+  configure
+  (
+    const interface_designator  id,
+    const offload_flags_t       offload
+  )
+  {
+    bool result = false;
+
+    if (id < interfaces_.size())
+    {
+      interfaces_[id].offload = offload;
+      result = true;
+    }
+   
+    return result;
+  }
+
+  interface_container&
+  interfaces()
+  {
+    return interfaces_;
+  }
+
+  /// Frame pool shared by all interfaces, e.g. to read its statistics
+  const payload_buffer_container<Config>&
+  pool() const
+  {
+    return pool_;
+  }
+
+  /// Binds the port to the interface designated by id. If id is 
+  /// c_any_interface, datagrams arriving on any interface are received. 
+  /// A port bound to a specific interface takes precedence over the same 
+  /// port bound to all interfaces. Binding a port already bound to the 
+  /// same interface fails.
+  endpoint_designator
+  bind
+  (
+    const interface_designator  id,
+    const uint16_t              port
+  )
+  {
+    endpoint_designator  result;
+
+    TRACE("Binding " << port << " to " << id << "\n");
+    
+    if ( id < interfaces_.size() || id == c_any_interface )
+    {
+      auto it = 
+        std::find_if
+        (
+          std::begin(udp_ports_), 
+          std::end(udp_ports_), 
+          [](auto &p) 
+          {
+            return !p.is_bound();
+          }
+        );
+      
+      if (it != std::end(udp_ports_))
+      {
+        std::size_t index = std::distance(std::begin(udp_ports_), it);
+        
+        if (udp_demux_.insert(id, port, index))
+        {
+          *it = (id == c_any_interface) ? 
+                  port_descriptor<Config>(port) : 
+                  port_descriptor<Config>(interfaces_[id], port);
+
+          result = index;
+        }
+      }
+    }
+    // Return the port index
+    return result;
+  }
+
+  /// Releases the port, the datagrams received but not read are discarded.
+  /// The designator is invalid after the call, and the port can be bound 
+  /// again.
+  bool
+  unbind
+  (
+    const endpoint_designator&  ed
+  )
+  {
+    bool result = false;
+    
+    if (is_valid(ed))
+    {
+      auto &p = udp_ports_[*ed];
+      
+      while (!p.rx_buffer_descriptor_refs.empty())
+      {
+        buffer_descriptor<Config> &bd = *p.rx_buffer_descriptor_refs.front();
+        p.rx_buffer_descriptor_refs.pop();
+        release_bd(bd);
+      }
+      
+      udp_demux_.remove
+      (
+        p.intf_ref ? designator_of(*p.intf_ref) : c_any_interface,
+        p.port
+      );
+      
+      p       = port_descriptor<Config>();
+      result  = true;
+    }
+    
+    return result;
+  }
+
+  std::size_t 
+  received_length
+  (
+    const endpoint_designator& ed
+  )
+  {
+    std::size_t result = 0;
+    
+    if (is_valid(ed))
+    {
+      auto &p       = udp_ports_[*ed];
+        
+      TRACE( __FUNCTION__ << " p.rx_buffer_descriptor_refs.size() " << p.rx_buffer_descriptor_refs.size() << " \n" );
+      
+      if (!p.rx_buffer_descriptor_refs.empty())
+      {
+        buffer_descriptor<Config> &bd = *p.rx_buffer_descriptor_refs.front();
+        result = bd.size;
+      }
+    }
+    
+    return result;
+  }
+
+  std::size_t
+  receive
+  (
+    const endpoint_designator&  ed,
+    uint8_t*                    data,
+    const std::size_t           size,
+    endpoint&                   remote
+  )
+  {
+    std::size_t  result = 0;
+    
+    if (is_valid(ed))
+    {
+      auto &p       = udp_ports_[*ed];
+      
+      if ( !p.rx_buffer_descriptor_refs.empty() )
+      {
+        buffer_descriptor<Config> &bd = *p.rx_buffer_descriptor_refs.front();
+        p.rx_buffer_descriptor_refs.pop();
+        
+        auto &f = bd.flags;
+        
+        if (f.template test<valid>())
+        {
+          auto read_size = std::min(size, bd.size);
+
+          std::memcpy(data, bd.first + bd.offset, read_size);
+          
+          remote = bd.remote;
+          result = read_size;
+
+          release_bd(bd);
+        }
+      }
+      else
+      {
+        TRACE("Nothing to receive\n");
+      }
+    }
+    else
+    {
+      TRACE("Endpoint invalid");
+    }
+    
+    return result;
+  }
+
+  /// Returns a view of the next received datagram without copying it. 
+  /// The datagram is removed from the receive queue of the port, but its 
+  /// buffer descriptor is owned by the application until the lease is 
+  /// released. An empty lease is returned if there is nothing to receive.
+  rx_lease<Config>
+  receive_view
+  (
+    const endpoint_designator&  ed
+  )
+  {
+    rx_lease<Config>  result;
+    
+    if (is_valid(ed))
+    {
+      auto &p = udp_ports_[*ed];
+      
+      if ( !p.rx_buffer_descriptor_refs.empty() )
+      {
+        buffer_descriptor<Config> &bd = *p.rx_buffer_descriptor_refs.front();
+        p.rx_buffer_descriptor_refs.pop();
+        
+        if (bd.flags.template test<valid>())
+        {
+          result.data   = bd.first + bd.offset;
+          result.size   = bd.size;
+          result.remote = bd.remote;
+          result.bd_ref = bd;
+        }
+      }
+      else
+      {
+        TRACE("Nothing to receive\n");
+      }
+    }
+    else
+    {
+      TRACE("Endpoint invalid");
+    }
+    
+    return result;
+  }
+
+  /// Returns the buffer descriptor of the lease to the stack. The lease is 
+  /// empty after the call.
+  void
+  release
+  (
+    rx_lease<Config>&  lease
+  )
+  {
+    if (lease.bd_ref)
+    {
+      release_bd(lease.bd_ref->get());
+    }
+    
+    lease = rx_lease<Config>();
+  }
+
+  /// Allocates a transmit descriptor with room for size bytes of payload
+  /// and the headers in front of it. The application writes the payload 
+  /// through the lease and commits it. A connected port transmits over 
+  /// the interface of its flow, otherwise over the interface it is bound
+  /// to. A port bound to all interfaces gets a lease only once it is 
+  /// connected, as its interface is routed from the remote; until then it
+  /// sends by send(). The payload of a lease is contiguous, so it shall 
+  /// fit in a single frame of the MTU of the interface, larger datagrams 
+  /// are sent by send().
+  tx_lease<Config>
+  acquire_tx
+  (
+    const endpoint_designator&  ed,
+    const std::size_t           size
+  )
+  {
+    return acquire_port_tx(ed, size, 1);
+  }
+
+  /// Commits the payload of the lease for transmission to remote. The 
+  /// headers and checksums are formed by step(). The lease is empty after 
+  /// the call. Returns the size of the payload committed.
+  std::size_t
+  commit_tx
+  (
+    tx_lease<Config>&  lease,
+    const endpoint&    remote
+  )
+  {
+    std::size_t result = 0U;
+    
+    if (lease.bd_ref)
+    {
+      buffer_descriptor<Config> &bd = *lease.bd_ref;
+      
+      bd.remote       = remote;
+      set_flags<transmit>(bd);
+      
+      result          = bd.size;
+    }
+    
+    lease = tx_lease<Config>();
+    
+    return result;
+  }
+
+  /// Commits the payload of the lease for transmission to the remote of 
+  /// the connected port it is acquired from. The lease is discarded if the
+  /// port is disconnected, or bound to another port, since. Returns the 
+  /// size of the payload committed.
+  std::size_t
+  commit_tx
+  (
+    tx_lease<Config>&  lease
+  )
+  {
+    std::size_t result = 0U;
+    
+    if (lease.bd_ref && is_connected(*lease.bd_ref))
+    {
+      result = commit_tx(lease, lease.bd_ref->get().flow_ref->get().remote);
+    }
+    else
+    {
+      release(lease);
+    }
+    
+    return result;
+  }
+
+  /// Discards the lease without transmission
+  void
+  release
+  (
+    tx_lease<Config>&  lease
+  )
+  {
+    if (lease.bd_ref)
+    {
+      release_bd(lease.bd_ref->get());
+    }
+    
+    lease = tx_lease<Config>();
+  }
+
+  std::size_t
+  send
+  (
+    const endpoint_designator&  ed,
+    const uint8_t               *data,
+    const std::size_t           size,
+    const endpoint&             remote
+  )
+  {
+    std::size_t result = 0U;
+    
+    if (is_valid(ed))
+    {
+      auto      &p = udp_ports_[*ed];
+      interface<Config> &i = p.intf_ref ? p.intf_ref->get() : route(remote.ip_addr);
+
+      auto lease = acquire_tx(i, p.port, size, config::tx_queue_size);
+      
+      if (lease)
+      {
+        copy_payload(i, lease, data, size);
+        
+        result = commit_tx(lease, remote);
+      }
+    }
+    
+    return result;
+  }
+
+  /// Connects the port to remote. Datagrams sent through a connected port
+  /// without a remote are formed from a prebuilt header template. A port 
+  /// bound to all interfaces is connected through the interface routing 
+  /// remote. Returns false if the endpoint is invalid
+  bool
+  connect
+  (
+    const endpoint_designator&  ed,
+    const endpoint&             remote
+  )
+  {
+    bool result = false;
+    
+    if (is_valid(ed))
+    {
+      auto      &p = udp_ports_[*ed];
+      interface<Config> &i = p.intf_ref ? p.intf_ref->get() : route(remote.ip_addr);
+
+      build_udp_flow(designator_of(i), i, p.flow, p.port, remote);
+      
+      result = true;
+    }
+    
+    return result;
+  }
+
+  void
+  disconnect
+  (
+    const endpoint_designator&  ed
+  )
+  {
+    if (is_valid(ed))
+    {
+      udp_ports_[*ed].flow = udp_flow();
+    }
+  }
+
+  /// Sends the payload to the remote of the connected port
+  std::size_t
+  send
+  (
+    const endpoint_designator&  ed,
+    const uint8_t               *data,
+    const std::size_t           size
+  )
+  {
+    std::size_t result = 0U;
+    
+    if (is_valid(ed) && udp_ports_[*ed].flow.is_connected())
+    {
+      auto lease = acquire_port_tx(ed, size, config::tx_queue_size);
+      
+      if (lease)
+      {
+        copy_payload(interfaces_[udp_ports_[*ed].flow.intf], lease, data, size);
+        
+        result = commit_tx(lease);
+      }
+    }
+    
+    return result;
+  }
+
+private: // Methods
+
+  void
+  copy_payload
+  (
+    interface<Config>&  i,
+    tx_lease<Config>&   lease,
+    const uint8_t       *data,
+    const std::size_t   size
+  )
+  {
+    buffer_descriptor<Config> &bd         = *lease.bd_ref;
+    const std::size_t         data_size   = bd.fragment_size;
+    const bool                f_sum       = 
+      config::udp_checksum_enabled && 
+      !is_l4_checksum_offloaded(i, bd);
+    uint64_t                  sum         = 0U;
+    
+    // The payload is summed while it is copied, so that it is not read 
+    // again when the UDP checksum is formed. The payload of a fragmented 
+    // datagram is copied straight to its fragments, the pieces start at 
+    // even offsets of the datagram so their sums add up
+    for (std::size_t k = 0; k < size; )
+    {
+      const std::size_t offset  = sizeof(udp_packet) + k;
+      const std::size_t n       = std::min(size - k, data_size - offset % data_size);
+      
+      if (f_sum)
+      {
+        sum = checksum_copy(sum, datagram_at(bd, offset), data + k, n);
+      }
+      else
+      {
+        std::memcpy(datagram_at(bd, offset), data + k, n);
+      }
+      
+      k += n;
+    }
+
+    if (f_sum)
+    {
+      bd.payload_sum = sum;
+      bd.flags.template set<summed>();
+    }
+    
+    TRACE(__FUNCTION__ << "-> tx payload:" << std::string(data, data + size) << "\n" );
+  }
+
+  /// Forms the frame of a descriptor committed for transmission and 
+  /// queues it, or holds the descriptor until the next hop is resolved
+  void
+  process_tx_descriptor
+  (
+    interface<Config>&          i,
+    buffer_descriptor<Config>&  bd
+  )
+  {
+    auto &f = bd.flags;
+    
+    // Packets pending are held until the next hop is resolved
+    if (f.template test<valid>() && f.template test<transmit>() && !f.template test<pending>())
+    {
+      TRACE(__FUNCTION__ << ": Process paket\n");
+      
+      switch(bd.ip_protocol)
+      {
+        default:
+          release_bd(bd);
+          break;
+        case UDP:
+          TRACE(__FUNCTION__ << ": Paket is UDP\n");
+          if (resolve_udp_flow(i, bd))
+          {
+            TRACE(__FUNCTION__ << ": Connected flow is resolved\n");
+            
+            if (i.tx_frame_count + bd.fragments <= i.tx_frames.size())
+            {
+              auto size = write_connected_udp_packet(i, *bd.flow_ref, bd, ip_identification_++);
+              
+              queue_frame(i, bd, size);
+            }
+          }
+          else
+          {
+            auto e_ref = find_arp_entry(i, bd.remote.ip_addr);
+            
+            if ( e_ref && e_ref->get().is_complete() )
+            {
+              TRACE(__FUNCTION__ << ": Found in ARP Table and ARP entry is complete\n");
+              
+              // The packet waits for the next step if the queue is full
+              if (i.tx_frame_count + bd.fragments <= i.tx_frames.size())
+              {
+                auto size = write_udp_packet(i, *e_ref, bd, ip_identification_++);
+                
+                queue_frame(i, bd, size);
+              }
+            }
+            else
+            {
+              TRACE(__FUNCTION__ << ": Not resolved, packet is held\n");
+
+              // Queues ARP request for a new resolution
+              hold_packet(i, bd);
+            }
+          }
+          break;
+      }
+    }
+  }
+
+  /// Writes the queued frames of the interface in a single call. Frames 
+  /// which the driver does not accept remain queued for the next step
+  template
+  <
+    typename WriteFunction
+  >
+  void
+  flush_tx_frames
+  (
+    const interface_designator  id,
+    interface<Config>&          i,
+    WriteFunction               write
+  )
+  {
+    if (i.tx_frame_count > 0)
+    {
+      std::size_t n = 
+        write
+        (
+          id,
+          static_cast<const frame*>(i.tx_frames.data()), 
+          i.tx_frame_count
+        );
+
+      TRACE(__FUNCTION__ << ": " << n << " of " << i.tx_frame_count << " frame(s) written\n");
+
+      release_tx_frames(i, n);
+    }
+  }
+
+  /// Processes a received frame, buffer is the block of the frame pool it
+  /// is read into and handle the frame of the driver it is handed over as,
+  /// or nullptr. Returns true if a descriptor took the block or the frame 
+  /// over, it is then returned with the descriptor
+  bool
+  process_received_frame
+  (
+    interface<Config>&  i, 
+    const frame&        f,
+    uint8_t             *buffer,
+    const frame_handle  *handle,
+    bool                p_soft_address_match,
+    bool                p_allow_broadcast
+  )
+  {
+    bool                result = false;
+    packet_metadata     m;
+    static const ethernet::address  broadcast_hw_addr{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+    TRACE(__FUNCTION__ << "\n");
+
+    TRACE("RX length:" << f.size << "\n");
+
+    if (parse_frame(f, frame_size(i.mtu), m))
+    {    
+      const eth_packet_header *eth = m.header<eth_packet_header>(0);
+
+      TRACE("Dest Addr :" << eth->dest_hw_addr << "\n");
+      TRACE("Src Addr  :" << eth->source_hw_addr << "\n");
+      TRACE("Type      :" << std::hex << m.ether_type.value() << std::dec << "(H) \n");
+
+      m.checksum_verified = 
+        i.offload.template test<offload_rx>() && 
+        f.flags.test<checksum_verified>();
+      m.buffer            = buffer;
+      m.handle            = handle;
+
+      if 
+      ( 
+        (p_allow_broadcast && (broadcast_hw_addr == eth->dest_hw_addr)) ||
+        (p_soft_address_match && (i.hw_addr == eth->dest_hw_addr)) 
+      )
+      {
+        TRACE("Valid Frame\n");
+        switch(m.ether_type.raw())
+        {
+        case c_ether_type_ipv4.raw():
+          TRACE("IPv4 packet\n");
+          result = process_ip_packet(i, m);
+          break;  
+        case c_ether_type_arp.raw():
+          TRACE("ARP packet\n");
+          process_arp_packet(i, m);
+          break;  
+        default:
+          break;
+        }
+      }
+      else
+      {
+        // Unsupported Frame
+      }
+    }
+    else
+    {
+      TRACE("Malformed or unsupported frame\n");
+    }
+    
+    return result;
+  }
+
+  /// Returns true if the block or the frame is taken over
+  bool
+  process_ip_packet
+  (
+    interface<Config>&      i,
+    const packet_metadata&  m
+  )
+  {
+    bool            result = false;
+    const ip_packet *ip = m.header<ip_packet>(m.l3_offset);
+    checksum  ip_checksum;
+
+    if (!m.checksum_verified)
+    {
+      ip_checksum.append(ip, sizeof(ip_packet));
+    }
 
-#ifndef DEBUG
+    if (!m.checksum_verified && ip_checksum.finalize() != 0)
+    {
+      TRACE(__FUNCTION__ << " : IP header checksum error\n");
+      i.statistics.ip_checksum_errors++;
+    }
+    else
+    {
+      TRACE("IP DEST IP:" << ip->dest_ip << "\n");
+      TRACE("IP SRC  IP:" << ip->src_ip << "\n");
+      TRACE("IP PROTO  :" << uint32_t(m.ip_protocol) << "\n");
 
-#include "builtin.h"
+      if (ip->dest_ip == i.ip_addr)
+      {
+        if (m.is_fragment)
+        {
+          // Not instantiated unless fragments are reassembled
+          if constexpr (config::reassembly_table_size > 0)
+          {
+            auto bd_ref = reassemble_fragment(i, m);
+            
+            if (bd_ref)
+            {
+              process_reassembled_udp_datagram(i, *bd_ref);
+            }
+          }
+        }
+        else if (m.ip_protocol == UDP) 
+        {
+          result = process_udp_packet(i, m);
+        }
+        else if (m.ip_protocol == ICMP) 
+        {
+          // Not instantiated unless echo requests are answered
+          if constexpr (config::icmp_enabled)
+          {
+            process_icmp_packet(i, m, ip_identification_);
+          }
+        }
+      }
+    }
+    
+    return result;
+  }
 
-#define ntohs(inval) BSWAP16(inval)
-#define htons(inval) BSWAP16(inval)
+  /// Queues the datagram to its port. Its descriptor takes over the block
+  /// of the frame if it is in the pool, or the frame if it is handed over 
+  /// by the driver, and the payload is summed in place. Otherwise the 
+  /// payload is copied and summed at the same time. Returns true if the 
+  /// block or the frame is taken over
+  bool
+  process_udp_packet
+  (
+    interface<Config>&      i,
+    const packet_metadata&  m
+  )
+  {
+    bool              result    = false;
+    const ip_packet   *ip_ptr   = m.header<ip_packet>(m.l3_offset);
+    const udp_packet  *udp_ptr  = m.header<udp_packet>(m.l4_offset);
+    const uint8_t     *payload  = m.frame + m.payload_offset;
+    const unsigned  size      = m.payload_size;
+    const uint16_t  src_port  = udp_ptr->src_port.value();
+    const uint16_t  dest_port = udp_ptr->dest_port.value();
 
-#define ntohl(inval) BSWAP32(inval)
-#define htonl(inval) BSWAP32(inval)
+    // A zero checksum is not computed by the sender, and a verified one is
+    // not checked again. Otherwise the pseudo header and the header are 
+    // summed in network order here
+    const bool  has_checksum  = 
+      config::udp_checksum_enabled && 
+      (udp_ptr->checksum != 0) && 
+      !m.checksum_verified;
+    checksum    udp_checksum;
 
-#else
+    if (has_checksum)
+    {
+      udp_checksum.append(&ip_ptr->src_ip, sizeof(ip_ptr->src_ip));
+      udp_checksum.append(&ip_ptr->dest_ip, sizeof(ip_ptr->dest_ip));
+      udp_checksum.append(be16(UDP));
+      udp_checksum.append(udp_ptr->length);
+      udp_checksum.append(udp_ptr, sizeof(udp_packet));
+    }
 
-inline uint16_t ntohs(uint16_t   p_value)
-{
-  uint8_t *ptr = reinterpret_cast<uint8_t*>(&p_value);
-  uint8_t tmp  = ptr[0];
-  ptr[0] = ptr[1];
-  ptr[1] = tmp;
-  return p_value;
-}
+    auto index = udp_demux_.find(designator_of(i), dest_port);
 
-inline uint16_t htons(uint16_t   p_value)
-{
-  return ntohs(p_value);
-}
+    TRACE(__FUNCTION__ << "\n");
+    TRACE("UDP SRC PORT:" << src_port << "\n");
+    TRACE("UDP DST PORT:" << dest_port << "\n");
 
-#define TRACE(P) std::cout<<P
+    if (index)
+    {
+      TRACE("UDP Valid\n");
 
-#endif
+      auto &p = udp_ports_[*index];
 
-namespace protocol
-{
+      if (!p.rx_buffer_descriptor_refs.full())
+      {
+        buffer_descriptor_ref<Config> bd_ref;
+        
+        if (m.buffer != nullptr)
+        {
+          bd_ref = 
+            adopt_bd
+            (
+              *i.pool, 
+              i.rx_buffer_descriptors, 
+              m.buffer,
+              m.payload_offset,
+              size
+            );
+          
+          if (bd_ref && has_checksum)
+          {
+            udp_checksum.append(payload, size);
+          }
+          
+          // A datagram dropped returns the block with its descriptor
+          result = bool(bd_ref);
+        }
+        else if (m.handle != nullptr)
+        {
+          bd_ref = 
+            adopt_bd
+            (
+              i.rx_buffer_descriptors, 
+              *m.handle,
+              i.frame_release,
+              m.payload_offset,
+              size
+            );
+          
+          if (bd_ref && has_checksum)
+          {
+            udp_checksum.append(payload, size);
+          }
+          
+          result = bool(bd_ref);
+        }
+        else
+        {
+          bd_ref = 
+            allocate_bd
+            (
+              *i.pool, 
+              i.rx_buffer_descriptors, 
+              size
+            );
+          
+          if (bd_ref)
+          {
+            uint8_t *ptr = bd_ref->get().first;
+            
+            if (has_checksum)
+            {
+              udp_checksum.sum = checksum_copy(udp_checksum.sum, ptr, payload, size);
+            }
+            else
+            {
+              std::memcpy(ptr, payload, size);
+            }
+          }
+        }
 
-namespace ipv4
-{
+        if (bd_ref)
+        {
+          buffer_descriptor<Config> &bd = *bd_ref;
+
+          if (has_checksum && udp_checksum.finalize() != 0)
+          {
+            TRACE(__FUNCTION__ << " : UDP checksum error\n");
+            release_bd(bd);
+            i.statistics.udp_checksum_errors++;
+          }
+          else
+          {
+            bd.remote = 
+              endpoint
+              {
+                ip_ptr->src_ip,
+                src_port
+              };
 
-extern interface_container        g_interfaces;
-extern arp_table_type             g_arp_table; 
-extern udp_ports_table_type       g_udp_ports; 
-extern std::size_t                g_ip_identification;
+            bd.port         = dest_port;
+            bd.ip_protocol  = UDP;
 
-struct checksum
-{
-  void append(const uint16_t p_value)
-  {
-    sum += p_value;
+            p.rx_buffer_descriptor_refs.push(bd_ref);
+          }
+        }
+        else
+        {
+          TRACE(__FUNCTION__ << " : ERROR! Cannot allocate Buffer Descriptor\n");
+        }
+      }
+    }
+    else
+    {
+      TRACE("UDP Invalid\n");
+    }
+    
+    return result;
   }
 
-  template<typename T>
-  void append(const T *p_ptr, const unsigned p_size_in_bytes)
+  /// Validates the UDP header and the checksum of a reassembled datagram, 
+  /// and queues it to the port like a datagram received in one frame. The
+  /// payload is summed while the fragments are copied, so it is not read 
+  /// again
+  void
+  process_reassembled_udp_datagram
+  (
+    interface<Config>&          i,
+    buffer_descriptor<Config>&  bd
+  )
   {
-    const uint16_t  *ptr = reinterpret_cast<const uint16_t*>(p_ptr);
-    unsigned  size = p_size_in_bytes >> 1;
+    const udp_packet  *udp_ptr  = reinterpret_cast<const udp_packet*>(bd.first);
+    bool              result    = 
+      (bd.size >= sizeof(udp_packet)) && 
+      (udp_ptr->length.value() == bd.size);
+    
+    if (result && config::udp_checksum_enabled && (udp_ptr->checksum != 0))
+    {
+      checksum  udp_checksum;
+      
+      udp_checksum.append(&bd.remote.ip_addr, sizeof(bd.remote.ip_addr));
+      udp_checksum.append(&i.ip_addr, sizeof(i.ip_addr));
+      udp_checksum.append(be16(UDP));
+      udp_checksum.append(udp_ptr->length);
+      udp_checksum.sum += bd.payload_sum;
+      
+      if (udp_checksum.finalize() != 0)
+      {
+        TRACE(__FUNCTION__ << " : UDP checksum error\n");
+        i.statistics.udp_checksum_errors++;
+        result = false;
+      }
+    }
+
+    std::optional<std::size_t> index;
     
-    for (unsigned u = 0; u < size; u++, ptr++)
+    if (result)
     {
-      sum += *ptr;
+      index = udp_demux_.find(designator_of(i), udp_ptr->dest_port.value());
     }
     
-    if ((p_size_in_bytes & 0x01) == 0x01)
+    if (index && !udp_ports_[*index].rx_buffer_descriptor_refs.full())
+    {
+      bd.remote.port  = udp_ptr->src_port.value();
+      bd.port         = udp_ptr->dest_port.value();
+      bd.offset       = sizeof(udp_packet);
+      bd.size        -= sizeof(udp_packet);
+
+      udp_ports_[*index].rx_buffer_descriptor_refs.push(buffer_descriptor_ref<Config>(bd));
+    }
+    else
     {
-      sum += *reinterpret_cast<const uint8_t*>(ptr);
+      TRACE(__FUNCTION__ << " : datagram dropped\n");
+      release_bd(bd);
     }
   }
-  
-  uint16_t finalize()
+
+  /// Allocates a transmit descriptor of the port, see acquire_tx. The 
+  /// payload may be fragmented into max_fragments frames
+  tx_lease<Config>
+  acquire_port_tx
+  (
+    const endpoint_designator&  ed,
+    const std::size_t           size,
+    const std::size_t           max_fragments
+  )
   {
-    while(sum >> 16)
+    tx_lease<Config>  result;
+    
+    if (is_valid(ed))
     {
-      sum = (sum >> 16) + (sum & 0xFFFF); 
+      auto      &p = udp_ports_[*ed];
+      
+      if (p.flow.is_connected())
+      {
+        result = acquire_tx(interfaces_[p.flow.intf], p.port, size, max_fragments);
+        
+        if (result)
+        {
+          result.bd_ref->get().flow_ref = p.flow;
+        }
+      }
+      else if (p.intf_ref)
+      {
+        result = acquire_tx(p.intf_ref->get(), p.port, size, max_fragments);
+      }
+      else
+      {
+        TRACE(__FUNCTION__ << ": port is bound to all interfaces and not connected\n");
+      }
     }
-    return ~sum;
+    
+    return result;
   }
-  
-  unsigned sum = 0U;
-};
-
-extern void
-process_received_frame
-(
-  interface&  i, 
-  bool        p_soft_address_match,
-  bool        p_allow_broadcast
-);
-
-extern void 
-write_udp_packet
-(
-  interface&          i,
-  arp_table_entry&    e, 
-  buffer_descriptor&  bd  
-);
-
-extern void 
-write_arp_packet
-(
-  interface&          i,
-  arp_table_entry&    e,
-  const bool          is_response
-);
-
-extern arp_table_entry_ref
-find_arp_entry
-(
-  const address& a
-);
 
-template
-<
-  typename IsRxAvailableFunction,
-  typename ReadFunction,
-  typename WriteFunction
->
-inline void 
-step
-(
-  IsRxAvailableFunction   is_rx_available,
-  ReadFunction            read,
-  WriteFunction           write
-)
-{
-  for(auto &i : g_interfaces)
+  /// Allocates a transmit descriptor for a UDP payload of size bytes. A 
+  /// payload which does not fit in a frame of the MTU of the interface is 
+  /// fragmented, up to max_fragments frames. Fragments of a datagram are 
+  /// queued together, so at most config::tx_queue_size
+  tx_lease<Config>
+  acquire_tx
+  (
+    interface<Config>&  i,
+    const uint16_t      port,
+    const std::size_t   size,
+    const std::size_t   max_fragments
+  )
   {
-    i.tx_frame_size = 0U;
-
-    if (is_rx_available())
+    tx_lease<Config>  result;
+    
+    if 
+    (
+      (size <= c_max_udp_payload_size) && 
+      (fragment_count(i.mtu, size) <= max_fragments)
+    )
     {
-      i.rx_frame_size = 
-        read
+      auto bd_ref = 
+        allocate_bd
         (
-          i.rx_frame_buffer, 
-          i.rx_frame_buffer.size()
+          *i.pool, 
+          i.tx_buffer_descriptors, 
+          fragmented_size(i.mtu, size)
         );
       
-      if (i.rx_frame_size > 0)
+      if (bd_ref)
       {
-        process_received_frame(i, true, true);
+        buffer_descriptor<Config> &bd = *bd_ref;
+        
+        bd.offset         = c_udp_headroom;
+        bd.size           = size;
+        bd.port           = port;
+        bd.ip_protocol    = UDP;
+        bd.fragments      = uint16_t(fragment_count(i.mtu, size));
+        bd.fragment_size  = uint16_t(fragment_data_size(i.mtu));
+        
+        result.data       = bd.first + bd.offset;
+        result.size       = size;
+        result.bd_ref     = bd_ref;
       }
       else
       {
-        TRACE("ERROR ! Packet read\n");
+        TRACE("ERROR! Cannot allocate transmit buffer descriptor\n");
       }
     }
-    
-    if (i.tx_frame_size > 0u)
+    else
     {
-      // Immediate response for ARP and ICMP are priority
-      // Altough, fixed priority is not the best idea
-      write
-      (
-        i.tx_frame_buffer, 
-        i.tx_frame_size
-      );
+      TRACE(__FUNCTION__ << " UDP packet too big:" << size << "\n");
     }
-    else
+    
+    return result;
+  }
+
+  bool
+  is_valid
+  (
+    const endpoint_designator&  ed
+  ) const
+  {
+    return ed && (*ed < udp_ports_.size()) && udp_ports_[*ed].is_bound();
+  }
+
+  /// Returns true if the flow the descriptor is acquired through is still
+  /// connected from the port of the descriptor
+  bool
+  is_connected
+  (
+    const buffer_descriptor<Config>&  bd
+  ) const
+  {
+    return 
+      bd.flow_ref && 
+      bd.flow_ref->get().is_connected() && 
+      (bd.flow_ref->get().port == bd.port);
+  }
+
+  interface_designator
+  designator_of
+  (
+    const interface<Config>&  i
+  ) const
+  {
+    return std::distance(&interfaces_[0], &i);
+  }
+
+  /// Selects the interface for a destination when the sending port is bound
+  /// to all interfaces. The interface which already resolved the destination
+  /// is preferred, then the interface on whose subnet it is, otherwise the 
+  /// first interface is used.
+  interface<Config>&
+  route
+  (
+    const address&  a
+  )
+  {
+    for (auto &i : interfaces_)
     {
-      // No immediate response is required. Process user packets per step (! TO-DO:Check tx busy)
-      TRACE(__FUNCTION__ << ": Process user packets\n");
+      auto e_ref = find_arp_entry(i, a);
 
-      for (auto &bd : i.tx_buffer_descriptors)
+      if (e_ref && e_ref->get().is_complete())
       {
-        auto &f = bd.flags;
-        
-        if (f.test<valid>())
-        {
-          TRACE(__FUNCTION__ << ": Process paket\n");
-          
-          switch(bd.ip_protocol)
-          {
-            default:
-              f.clear<valid, pending>();
-              break;
-            case UDP:
-              TRACE(__FUNCTION__ << ": Paket is UDP\n");
-              {
-                auto e_ref = find_arp_entry(bd.remote.ip_addr);
-                
-                if ( e_ref )
-                {
-                  arp_table_entry &e = *e_ref;
-                  
-                  TRACE(__FUNCTION__ << ": Found in ARP Table\n");
-                  
-                  if ( e.is_complete() )
-                  {
-                    TRACE(__FUNCTION__ << ": and ARP entry is complete\n");
-                    
-                    write_udp_packet(i, e, bd);
-                    
-                    f.clear<valid>();
-                  }
-                  else
-                  {
-                    TRACE(__FUNCTION__ << ": ARP entry is incomplete\n");
-                    // TO-DO... while waiting for response
-                    //   retry or remove entry
-                  }
-                }
-                else
-                {
-                  TRACE(__FUNCTION__ << ": Not in ARP table\n");
-
-                  auto r = haluj::bounded::push_back
-                  (
-                    g_arp_table,
-                    arp_table_entry
-                    {
-                      {0xFF, 0xFF, 0XFF, 0xFF, 0xFF, 0XFF},
-                      bd.remote.ip_addr,
-                      false
-                    }
-                  );
-
-                  if (r)
-                  {
-                    write_arp_packet(i, g_arp_table.back(), false);
-                  }
-                }
-              }
-              
-              if (i.tx_frame_size > 0)
-              {
-                write
-                (
-                  i.tx_frame_buffer, 
-                  i.tx_frame_size
-                );
-              }
+        return i;
+      }
+    }
 
-              break;
-          }
-        }
+    for (auto &i : interfaces_)
+    {
+      if (is_on_subnet(i, a))
+      {
+        return i;
       }
     }
+
+    return interfaces_[0];
   }
+
+
+private: // Members
+
+  /// Frames received, datagrams sent and control frames of all interfaces
+  /// are allocated from a single pool, so the memory is shared as the 
+  /// traffic of the interfaces requires
+  payload_buffer_container<Config>  pool_;
+  /// Frame read when the pool has no block left, see step()
+  std::array
+  <
+    uint8_t, 
+    frame_size(Config::max_mtu)
+  >                                 rx_reserve_;
+  interface_container               interfaces_;
+  udp_ports_table_type              udp_ports_;
+  udp_demux_type                    udp_demux_;
+  std::size_t                       ip_identification_;
+};
+
+/// Default stack instance used by the free function interface
+extern stack<>                    g_stack;
+
+template
+<
+  typename IsRxAvailableFunction,
+  typename ReadFunction,
+  typename WriteFunction
+>
+inline void 
+step
+(
+  IsRxAvailableFunction   is_rx_available,
+  ReadFunction            read,
+  WriteFunction           write
+)
+{
+  g_stack.step(is_rx_available, read, write);
 }
 
 extern void 
@@ -280,7 +1493,36 @@ set
 (
   const interface_designator  id,
   ethernet::address           hw_addr, 
-  ipv4::address               ip_addr
+  ipv4::address               ip_addr,
+  ipv4::address               netmask = {0xFF, 0xFF, 0xFF, 0xFF}
+);
+
+extern bool
+configure
+(
+  const interface_designator  id,
+  const offload_flags_t       offload
+);
+
+extern bool
+set_mtu
+(
+  const interface_designator  id,
+  const std::size_t           mtu
+);
+
+extern bool
+set_frame_release
+(
+  const interface_designator  id,
+  frame_release_function      release
+);
+
+extern bool
+deliver
+(
+  const interface_designator  id,
+  const frame_handle&         h
 );
 
 namespace udp
@@ -293,6 +1535,12 @@ bind
   const uint16_t              port
 );
 
+extern bool
+unbind
+(
+  const endpoint_designator&  ed
+);
+
 extern std::size_t 
 received_length
 (
@@ -308,6 +1556,38 @@ receive
   endpoint&                   remote
 );
 
+extern rx_lease<>
+receive_view
+(
+  const endpoint_designator&  ed
+);
+
+extern void
+release
+(
+  rx_lease<>&  lease
+);
+
+extern tx_lease<>
+acquire_tx
+(
+  const endpoint_designator&  ed,
+  const std::size_t           size
+);
+
+extern std::size_t
+commit_tx
+(
+  tx_lease<>&                 lease,
+  const endpoint&             remote
+);
+
+extern void
+release
+(
+  tx_lease<>&  lease
+);
+
 extern std::size_t
 send
 (
@@ -317,6 +1597,33 @@ send
   const endpoint&             remote
 );
 
+extern std::size_t
+commit_tx
+(
+  tx_lease<>&  lease
+);
+
+extern bool
+connect
+(
+  const endpoint_designator&  ed,
+  const endpoint&             remote
+);
+
+extern void
+disconnect
+(
+  const endpoint_designator&  ed
+);
+
+extern std::size_t
+send
+(
+  const endpoint_designator&  ed,
+  const uint8_t               *data,
+  const std::size_t           size
+);
+
 } // namespace udp  
 
 } // namespace ipv4
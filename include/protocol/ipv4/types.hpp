@@ -33,9 +33,14 @@ For more information, please refer to <http://unlicense.org>
 #define PROTOCOL_IPV4_TYPES_HPP
 
 #include "constants.hpp"
+#include "config.hpp"
+#include "endian.hpp"
 
+#include <algorithm>
 #include <optional>
 #include <array>
+#include <bitset>
+#include <limits>
 
 #include "bit/field.hpp"
 #include "bit/pack.hpp"
@@ -45,6 +50,9 @@ For more information, please refer to <http://unlicense.org>
 
 #include "../ethernet/address.hpp"
 #include "../ipv4/address.hpp"
+#include "arp_cache.hpp"
+#include "reassembly.hpp"
+#include "allocator.hpp"
 
 namespace protocol
 {
@@ -59,11 +67,11 @@ using reference =
     std::reference_wrapper<T>
   >;
 
-template<typename T>
+template<typename T, std::size_t Size>
 using ring_buffer =
   haluj::ring_buffer
   <
-    std::array<T, 2>
+    std::array<T, Size>
   >;
 
 struct endpoint
@@ -72,21 +80,24 @@ struct endpoint
   uint16_t          port;
 };
 
+/// Header fields are in network byte order. Checksums are summed over 
+/// the bytes as they are on the wire, so they are kept as summed.
+
 struct eth_packet_header
 {
   ethernet::address   dest_hw_addr;
   ethernet::address   source_hw_addr;
-  uint16_t            type;
+  be16                type;
 };
 
 struct ip_packet
 {
   uint8_t         version_length;
   uint8_t         diff_serv;
-  uint16_t        total_length;
+  be16            total_length;
   ///
-  uint16_t        identification;
-  uint16_t        flags_fragment_offset;
+  be16            identification;
+  be16            flags_fragment_offset;
   ///
   uint8_t         ttl;
   uint8_t         protocol;
@@ -99,21 +110,21 @@ struct ip_packet
 
 struct udp_packet
 {
-  uint16_t src_port;
-  uint16_t dest_port;
+  be16      src_port;
+  be16      dest_port;
   ///
-  uint16_t length;
-  uint16_t checksum;
+  be16      length;
+  uint16_t  checksum;
 };
 
 struct arp_packet
 {
-  uint16_t      htype;
-  uint16_t      ptype;
+  be16          htype;
+  be16          ptype;
   /// 
   uint8_t       hlen;
   uint8_t       plen;
-  uint16_t      opcode;
+  be16          opcode;
   ///
   ethernet::address   sender_hw_addr;
   address             sender_ip_addr;
@@ -126,20 +137,164 @@ struct icmp_packet
   uint8_t     type;
   uint8_t     code;
   uint16_t    checksum;
-  uint16_t    identifier;
-  uint16_t    sequence_number;
+  be16        identifier;
+  be16        sequence_number;
 };
 
-struct context
+/// Field values in network byte order
+constexpr be16 c_ether_type_ipv4      = be16(0x0800);
+constexpr be16 c_ether_type_arp       = be16(0x0806);
+constexpr be16 c_arp_htype_ethernet   = be16(0x0001);
+constexpr be16 c_arp_opcode_request   = be16(0x0001);
+constexpr be16 c_arp_opcode_reply     = be16(0x0002);
+constexpr be16 c_ip_no_fragment       = be16(0x0000);
+constexpr be16 c_ip_dont_fragment     = be16(0x4000);
+
+/// Flags and fragment offset of the IP header in host byte order, the 
+/// offset is in units of 8 bytes
+constexpr uint16_t c_ip_flag_reserved         = 0x8000;
+constexpr uint16_t c_ip_flag_more_fragments   = 0x2000;
+constexpr uint16_t c_ip_fragment_offset_mask  = 0x1FFF;
+
+/// Space reserved in front of the payload of a transmit descriptor, so 
+/// that the frame is formed in place
+constexpr std::size_t c_udp_headroom = 
+  sizeof(eth_packet_header) + 
+  sizeof(ip_packet) + 
+  sizeof(udp_packet);
+
+/// Space reserved in front of the data of each fragment of a datagram
+constexpr std::size_t c_fragment_headroom = 
+  sizeof(eth_packet_header) + 
+  sizeof(ip_packet);
+
+/// Size of the frame carrying an IP packet of mtu bytes, without crc
+constexpr std::size_t
+frame_size
+(
+  const std::size_t mtu
+)
+{
+  return sizeof(eth_packet_header) + mtu;
+}
+
+/// Largest UDP payload, i.e. the largest IP datagram less the headers
+constexpr std::size_t c_max_udp_payload_size = 
+  0xFFFF - 
+  sizeof(ip_packet) - 
+  sizeof(udp_packet);
+
+/// checksum_verified: the MAC verified the checksums of the received frame
+struct checksum_verified : bit::field<0> {};
+
+using  frame_flags_t =
+  bit::storage
+  <
+    bit::pack
+    <
+      uint8_t,
+      checksum_verified
+    >
+  >;
+
+/// Frame exchanged with the driver. For reception the stack provides data
+/// and capacity, and the driver sets the size of the frame read and its 
+/// flags. For transmission data and size describe the frame to be written.
+struct frame
+{
+  uint8_t       *data     = nullptr;
+  std::size_t   capacity  = 0;
+  std::size_t   size      = 0;
+  frame_flags_t flags;
+};
+
+/// Received frame in memory of the driver, e.g. a slot of its DMA ring, 
+/// handed over to the stack by deliver(). The context is kept for the 
+/// driver, e.g. to find the slot when the frame is returned
+struct frame_handle
+{
+  uint8_t       *data     = nullptr;
+  std::size_t   size      = 0;
+  frame_flags_t flags;
+  void          *context  = nullptr;
+};
+
+/// Returns a frame handed over by deliver() to its driver
+typedef void (*frame_release_function)(const frame_handle &h);
+
+/// Checksum offload capabilities of the MAC of an interface
+/// offload_tx_ip:  IP header checksum is inserted on transmission
+/// offload_tx_l4:  UDP and ICMP checksums are inserted on transmission, 
+///                 the checksum field is left zero for the MAC
+/// offload_rx:     checksums are verified on reception, see frame flags
+struct offload_tx_ip  : bit::field<0> {};
+struct offload_tx_l4  : bit::field<1> {};
+struct offload_rx     : bit::field<2> {};
+
+using  offload_flags_t =
+  bit::storage
+  <
+    bit::pack
+    <
+      uint8_t,
+      offload_tx_ip,
+      offload_tx_l4,
+      offload_rx
+    >
+  >;
+
+/// Metadata of a received frame, produced by parse_frame in a single pass.
+/// Offsets are from the start of the frame. The headers up to the payload
+/// are validated to be within the frame, and the payload size excludes the
+/// Ethernet padding. Handlers consume the metadata instead of parsing the 
+/// frame again. The frame is only read, so it may be in a read only DMA 
+/// or shared region.
+struct packet_metadata
 {
-  uint8_t             *ptr        = nullptr;
-  uint8_t             *last       = nullptr;
-  ethernet::address   remote_hw_addr;  
+  /// Header of type T at the offset
+  template<typename T>
+  const T*
+  header
+  (
+    const std::size_t offset
+  ) const
+  {
+    return reinterpret_cast<const T*>(frame + offset);
+  }
+
+  const uint8_t *frame            = nullptr;
+  be16          ether_type        = be16(0);
+  uint16_t      l3_offset         = 0;
+  uint16_t      l4_offset         = 0;
+  uint16_t      payload_offset    = 0;
+  uint16_t      payload_size      = 0;
+  uint8_t       ip_protocol       = 0;
+  /// checksums are verified by the MAC and not checked again
+  bool          checksum_verified = false;
+  /// The packet is a fragment of a datagram, only its IP header is 
+  /// validated. The payload starts at fragment_offset bytes in the 
+  /// datagram
+  bool          is_fragment       = false;
+  bool          more_fragments    = false;
+  uint16_t      fragment_offset   = 0;
+  /// Block of the frame pool the frame is read into, a descriptor takes it
+  /// over instead of copying the payload. Null if the frame is in memory 
+  /// of the driver
+  uint8_t       *buffer           = nullptr;
+  /// Frame of the driver handed over to the stack, a descriptor takes it 
+  /// over instead of copying the payload. Null if the frame is not handed
+  /// over
+  const frame_handle  *handle     = nullptr;
 };
 
+/// valid:    descriptor is allocated
+/// pending:  transmission is held until the next hop is resolved
+/// transmit: descriptor is committed for transmission
+/// summed:   payload_sum holds the sum of the payload
 struct valid    : bit::field<0> {};
 struct pending  : bit::field<1> {};
 struct transmit : bit::field<2> {};
+struct summed   : bit::field<3> {};
 
 using  descriptor_flags_t =
   bit::storage
@@ -149,53 +304,338 @@ using  descriptor_flags_t =
       uint8_t,
       valid,
       pending,
-      transmit
+      transmit,
+      summed
     >
   >;
 
-typedef std::array<uint8_t, c_rx_buffer_size>           payload_buffer_container;
-typedef std::array<uint8_t, c_rx_buffer_size>::iterator payload_buffer_iterator;
+typedef std::size_t                                                     interface_designator;
+typedef std::optional<std::size_t>                                      endpoint_designator;
 
+/// Designates all interfaces, i.e. a port bound with this designator 
+/// receives datagrams arriving on any interface
+constexpr interface_designator c_any_interface = 
+  std::numeric_limits<interface_designator>::max();
+
+/// Prebuilt headers of a connected UDP port. The constant fields of the
+/// headers are summed once, so only the length, identification and 
+/// checksum fields are patched per datagram. The destination hardware 
+/// address is valid as long as the generation of the ARP table is 
+/// unchanged and the entry it is copied from is not expired.
+struct udp_flow
+{
+  bool is_connected() const
+  {
+    return connected;
+  }
+
+  std::array<uint8_t, c_udp_headroom>   header;
+  ipv4::endpoint                        remote;
+  /// interface the flow is connected through
+  interface_designator                  intf            = c_any_interface;
+  /// port the flow is connected from
+  uint16_t                              port            = 0;
+  /// unfolded sum of the IP header with length and identification zero
+  uint64_t                              ip_sum          = 0;
+  /// unfolded sum of the pseudo header and the UDP header with length 
+  /// zero
+  uint64_t                              udp_sum         = 0;
+  uint32_t                              arp_generation  = 0;
+  /// time the ARP entry was last updated
+  time_point                            arp_updated     = 0;
+  bool                                  resolved        = false;
+  bool                                  connected       = false;
+};
+
+typedef reference<udp_flow>                             udp_flow_ref;
+
+/// Size of the frame pool, which holds at least a burst of frames of the 
+/// largest MTU and a frame to send, so that a configuration raising 
+/// max_mtu or rx_burst_size needs no other change
+template<typename Config>
+constexpr std::size_t
+frame_pool_size()
+{
+  return 
+    std::max
+    (
+      Config::frame_pool_size, 
+      (Config::rx_burst_size + 1) * payload_allocation_size(frame_size(Config::max_mtu))
+    );
+}
+
+template<typename Config = default_config>
+using payload_buffer_container =
+  payload_allocator
+  <
+    frame_pool_size<Config>()
+  >;
+
+typedef uint8_t*                                        payload_buffer_iterator;
+
+template<typename Config>
+class buffer_descriptor_container;
+
+/// Fields tested on every step lead, the ones used only when the frame is
+/// formed or the descriptor is released follow
+template<typename Config = default_config>
 struct buffer_descriptor
 {
+  descriptor_flags_t        flags;
+  uint8_t                   ip_protocol;
+  uint16_t                  port;       
+  /// frames the datagram is sent in, more than one if it is fragmented
+  uint16_t                  fragments;
+  /// data of the datagram in each fragment but the last, set from the MTU
+  /// of the interface when the descriptor is allocated
+  uint16_t                  fragment_size;
   payload_buffer_iterator   first;
   payload_buffer_iterator   last;
+  /// offset of the payload from first, i.e. headroom reserved for headers
+  std::size_t               offset;
+  /// size of the payload
   std::size_t               size;
   ipv4::endpoint            remote;
-  uint16_t                  port;       
-  uint8_t                   ip_protocol;
-  descriptor_flags_t        flags;
+  /// unfolded checksum of the payload, summed while it is copied
+  uint64_t                  payload_sum;
+  /// flow of a connected port the payload is sent through
+  udp_flow_ref              flow_ref;
+  /// buffer the payload is allocated from, null if the payload is in a 
+  /// frame of the driver
+  payload_buffer_container<Config>      *buffer;
+  /// container the descriptor belongs to
+  buffer_descriptor_container<Config>   *container;
+  /// frame of the driver the payload is in, returned through release when
+  /// the descriptor is released
+  frame_handle                          handle;
+  frame_release_function                release;
 };
 
-typedef reference<buffer_descriptor>                              buffer_descriptor_ref;
-typedef std::array<buffer_descriptor, c_buffer_descriptor_size>   buffer_descriptor_container;
+template<typename Config = default_config>
+using buffer_descriptor_ref =
+  reference
+  <
+    buffer_descriptor<Config>
+  >;
 
-struct interface
+/// Buffer descriptors of one direction of an interface. The valid, 
+/// pending and transmit flags of the descriptors are mirrored in bitmaps,
+/// one bit per descriptor. A free descriptor is found with a bit scan, and
+/// the descriptors ready for transmission are visited without reading the
+/// flags of the others.
+template<typename Config = default_config>
+class buffer_descriptor_container
 {
-  ethernet::address                             hw_addr;
-  address                                       ip_addr;
-  payload_buffer_container                      rx_payload_buffer;
-  payload_buffer_container                      tx_payload_buffer;
-  buffer_descriptor_container                   rx_buffer_descriptors;
-  buffer_descriptor_container                   tx_buffer_descriptors;
-  std::array<uint8_t, c_max_eth_frame_size>     rx_frame_buffer;
-  std::array<uint8_t, c_max_eth_frame_size>     tx_frame_buffer;
-  std::size_t                                   rx_frame_size;
-  std::size_t                                   tx_frame_size;
+public: // Types
+
+  typedef buffer_descriptor<Config>   value_type;
+  typedef value_type*                 iterator;
+  typedef const value_type*           const_iterator;
+
+private: // Types
+
+  static constexpr std::size_t c_size   = Config::buffer_descriptor_size;
+  static constexpr std::size_t c_words  = (c_size + 31) / 32;
+
+  typedef std::array<uint32_t, c_words> bitmap_type;
+
+public: // Methods
+
+  value_type&
+  operator[]
+  (
+    const std::size_t k
+  )
+  {
+    return descriptors_[k];
+  }
+
+  const value_type&
+  operator[]
+  (
+    const std::size_t k
+  ) const
+  {
+    return descriptors_[k];
+  }
+
+  static constexpr std::size_t
+  size()
+  {
+    return c_size;
+  }
+
+  iterator begin()
+  {
+    return descriptors_.data();
+  }
+
+  iterator end()
+  {
+    return descriptors_.data() + c_size;
+  }
+
+  const_iterator begin() const
+  {
+    return descriptors_.data();
+  }
+
+  const_iterator end() const
+  {
+    return descriptors_.data() + c_size;
+  }
+
+  /// Returns the index of the first free descriptor, size() if all are 
+  /// allocated
+  std::size_t
+  find_free() const
+  {
+    std::size_t result = c_size;
+    
+    for (std::size_t w = 0; w < c_words; w++)
+    {
+      const uint32_t available = ~valid_[w];
+      
+      if (available != 0)
+      {
+        // bits beyond the last descriptor are free as well
+        result = std::min(c_size, w * 32 + find_first_set(available));
+        break;
+      }
+    }
+    
+    return result;
+  }
+
+  /// Calls fn with each descriptor which is valid, committed for 
+  /// transmission and not pending, in order. fn may change the flags of 
+  /// the descriptor it is called with, or release it.
+  template<typename Function>
+  void
+  for_each_ready
+  (
+    Function  fn
+  )
+  {
+    for (std::size_t w = 0; w < c_words; w++)
+    {
+      uint32_t ready = valid_[w] & transmit_[w] & ~pending_[w];
+      
+      for (; ready != 0; ready &= ready - 1)
+      {
+        fn(descriptors_[w * 32 + find_first_set(ready)]);
+      }
+    }
+  }
+
+  std::size_t
+  index_of
+  (
+    const value_type& bd
+  ) const
+  {
+    return std::size_t(&bd - descriptors_.data());
+  }
+
+  /// Mirrors the flags of the descriptor in the bitmaps, after they are 
+  /// changed
+  void
+  update
+  (
+    const value_type& bd
+  )
+  {
+    const std::size_t k = index_of(bd);
+    
+    assign(valid_,    k, bd.flags.template test<valid>());
+    assign(pending_,  k, bd.flags.template test<pending>());
+    assign(transmit_, k, bd.flags.template test<transmit>());
+  }
+
+  void
+  reset()
+  {
+    valid_.fill(0);
+    pending_.fill(0);
+    transmit_.fill(0);
+  }
+
+private: // Methods
+
+  static void
+  assign
+  (
+    bitmap_type&      bitmap,
+    const std::size_t k,
+    const bool        f_set
+  )
+  {
+    const uint32_t bit = uint32_t(1) << (k % 32);
+    
+    if (f_set)
+    {
+      bitmap[k / 32] |= bit;
+    }
+    else
+    {
+      bitmap[k / 32] &= ~bit;
+    }
+  }
+
+private: // Members
+
+  bitmap_type                       valid_      = {};
+  bitmap_type                       pending_    = {};
+  bitmap_type                       transmit_   = {};
+  std::array<value_type, c_size>    descriptors_;
 };
 
-typedef reference<interface>                interface_ref;
+/// View of the payload of a received datagram. The buffer descriptor 
+/// holding the payload remains allocated until the lease is released.
+template<typename Config = default_config>
+struct rx_lease
+{
+  explicit operator bool() const
+  {
+    return bd_ref.has_value();
+  }
+  
+  const uint8_t           *data   = nullptr;
+  std::size_t             size    = 0;
+  ipv4::endpoint          remote;
+  buffer_descriptor_ref<Config>   bd_ref;
+};
+
+/// Payload space of a datagram to be transmitted. The application writes 
+/// the payload in place, the headers are formed in front of it on 
+/// transmission.
+template<typename Config = default_config>
+struct tx_lease
+{
+  explicit operator bool() const
+  {
+    return bd_ref.has_value();
+  }
+  
+  uint8_t                 *data   = nullptr;
+  std::size_t             size    = 0;
+  buffer_descriptor_ref<Config>   bd_ref;
+};
 
 struct arp_table_entry
 {
   /// Types
-  struct complete : bit::field<0> {};
+  struct complete   : bit::field<0> {};
+  struct occupied   : bit::field<1> {};
+  struct referenced : bit::field<2> {};
   
   using  flags_pack_t =
     bit::pack
     <
       uint8_t,
-      complete
+      complete,
+      occupied,
+      referenced
     >;
     
   using flags_t = 
@@ -204,14 +644,26 @@ struct arp_table_entry
   /// Constructors
   
   arp_table_entry()
+  : elapsed(0)
   {}
 
   arp_table_entry(const arp_table_entry& other)
   : hw_addr(other.hw_addr),
     ip_addr(other.ip_addr),
-    flags(other.flags)
+    flags(other.flags),
+    elapsed(other.elapsed)
   {}
 
+  arp_table_entry&
+  operator=(const arp_table_entry& other)
+  {
+    hw_addr = other.hw_addr;
+    ip_addr = other.ip_addr;
+    flags   = other.flags;
+    elapsed = other.elapsed;
+    return *this;
+  }
+
   arp_table_entry
   (
     const ethernet::address&  hwa,
@@ -219,7 +671,8 @@ struct arp_table_entry
     const bool                f_complete
   )
   : hw_addr(hwa),
-    ip_addr(ipa)
+    ip_addr(ipa),
+    elapsed(0)
   {
     if(f_complete)
       flags.set<complete>();
@@ -243,6 +696,36 @@ struct arp_table_entry
   {
     flags.clear<complete>();
   }
+
+  bool is_occupied() const
+  {
+    return flags.test<occupied>();
+  }
+  
+  void set_occupied()
+  {
+    flags.set<occupied>();
+  }
+
+  void clear_occupied()
+  {
+    flags.clear<occupied, referenced>();
+  }
+
+  bool is_referenced() const
+  {
+    return flags.test<referenced>();
+  }
+  
+  void set_referenced()
+  {
+    flags.set<referenced>();
+  }
+
+  void clear_referenced()
+  {
+    flags.clear<referenced>();
+  }
   
   /// Member Variables
 
@@ -252,46 +735,244 @@ struct arp_table_entry
   /// ip addr. In case of sending of a ARP request this flag shall remain 
   /// 0 until the response
   flags_t             flags;
-  /// elapsed is not implemented yet. It shall be used to determine the time for 
-  /// incomplete entry. 
-  // time_point       elapsed;
+  /// elapsed is the time of the last update of the entry. The age of the 
+  /// entry is measured from elapsed to expire complete and incomplete 
+  /// entries.
+  time_point          elapsed;
 };
 
 typedef reference<arp_table_entry>                arp_table_entry_ref;
 
+template<typename Config = default_config>
+using arp_table_type =
+  arp_cache
+  <
+    arp_table_entry, 
+    Config::arp_table_size,
+    Config::arp_probe_limit,
+    Config::arp_entry_lifetime,
+    Config::arp_incomplete_lifetime
+  >;
+
+/// Packets held while the hardware address of the next hop is resolved.
+/// A resolution is active as long as it holds packets.
+template<typename Config = default_config>
+struct arp_resolution
+{
+  bool is_active() const
+  {
+    return !queue.empty();
+  }
+
+  address                   next_hop;
+  /// time of the next retry
+  time_point                deadline;
+  uint8_t                   retries;
+  haluj::bounded::vector
+  <
+    buffer_descriptor_ref<Config>,
+    Config::arp_hold_queue_size
+  >                         queue;
+};
+
+template<typename Config = default_config>
+using arp_resolution_ref =
+  reference
+  <
+    arp_resolution<Config>
+  >;
+
+template<typename Config = default_config>
+using arp_resolution_table_type =
+  std::array
+  <
+    arp_resolution<Config>, 
+    Config::arp_pending_table_size
+  >;
+
+/// Datagram being reassembled. Its fragments are copied straight to their
+/// place in the payload of the descriptor, which is delivered as is once 
+/// the datagram is complete. The payload is summed while it is copied.
+template<typename Config = default_config>
+struct reassembly
+{
+  static_assert
+  (
+    Config::reassembly_max_size <= 0xFFFF - sizeof(ip_packet), 
+    "reassembly_max_size exceeds the largest IP payload"
+  );
+
+  bool is_occupied() const
+  {
+    return occupied;
+  }
+  
+  void set_occupied()
+  {
+    occupied = true;
+  }
+
+  void clear_occupied()
+  {
+    occupied = false;
+  }
+
+  fragment_key                                key;
+  hole_list<Config::reassembly_hole_limit>    holes;
+  buffer_descriptor_ref<Config>               bd_ref;
+  /// time the datagram is discarded unless it is complete
+  time_point                                  deadline  = 0;
+  /// size of the datagram, known once its last fragment arrives
+  std::size_t                                 size      = 0;
+  bool                                        occupied  = false;
+};
+
+template<typename Config = default_config>
+using reassembly_table_type =
+  reassembly_table
+  <
+    reassembly<Config>, 
+    Config::reassembly_table_size
+  >;
+
+template<typename Config = default_config>
+using reassembly_table_entry_ref =
+  typename reassembly_table_type<Config>::entry_ref;
+
+struct interface_statistics
+{
+  /// packets dropped as the hold queue or resolution table was full
+  std::size_t   arp_hold_drops          = 0;
+  /// packets dropped as the resolution of the next hop failed
+  std::size_t   arp_resolution_drops    = 0;
+  std::size_t   arp_requests            = 0;
+  /// IP packets dropped as their header checksum did not match
+  std::size_t   ip_checksum_errors      = 0;
+  /// UDP datagrams dropped as their checksum did not match
+  std::size_t   udp_checksum_errors     = 0;
+  /// ICMP messages dropped as their checksum did not match, when 
+  /// icmp_checksum_enabled
+  std::size_t   icmp_checksum_errors    = 0;
+  /// control frames dropped as the TX queue or the frame pool was full
+  std::size_t   tx_drops                = 0;
+  /// datagrams discarded as their fragments did not arrive in time
+  std::size_t   reassembly_timeouts     = 0;
+  /// fragments dropped as their datagram could not be reassembled, e.g. 
+  /// it is too large, its fragments overlap or there is no space left
+  std::size_t   reassembly_drops        = 0;
+};
+
+/// Fields used on every step lead and share the first cache line. The 
+/// descriptors, ARP state and reassembly state follow, each starting on a
+/// cache line of its own, so that the RX and TX paths do not share lines.
+/// Frames and payloads are held in the frame pool of the stack, shared by
+/// all interfaces.
+template<typename Config = default_config>
+struct interface
+{
+  alignas(Config::cache_line_size)
+  ethernet::address                             hw_addr;
+  address                                       ip_addr;
+  /// ip_addr masked by the netmask is the subnet of the segment, which
+  /// holds only ip_addr unless the netmask is set
+  address                                       netmask = {0xFF, 0xFF, 0xFF, 0xFF};
+  offload_flags_t                               offload;
+  /// largest IP packet sent or received, up to Config::max_mtu
+  std::size_t                                   mtu = Config::max_mtu;
+  /// frame pool of the stack
+  payload_buffer_container<Config>              *pool = nullptr;
+  /// returns the frames handed over by deliver(), none if they are only 
+  /// lent for the call
+  frame_release_function                        frame_release = nullptr;
+  std::size_t                                   tx_frame_count = 0;
+  /// Frames formed but not yet written by the driver. The last frame of a 
+  /// datagram refers to its TX buffer descriptor. Control frames, i.e. 
+  /// ARP and ICMP, are marked in tx_control_frames and their blocks are 
+  /// returned to the pool once written
+  std::array<frame, Config::tx_queue_size>      tx_frames;
+  std::array
+  <
+    buffer_descriptor_ref<Config>, 
+    Config::tx_queue_size
+  >                                             tx_frame_bds;
+  std::bitset<Config::tx_queue_size>            tx_control_frames;
+  std::array<frame, Config::rx_burst_size>      rx_frames;
+  interface_statistics                          statistics;
+  alignas(Config::cache_line_size)
+  buffer_descriptor_container<Config>           rx_buffer_descriptors;
+  alignas(Config::cache_line_size)
+  buffer_descriptor_container<Config>           tx_buffer_descriptors;
+  /// ARP state is kept per interface, as each interface is attached to 
+  /// a different segment
+  alignas(Config::cache_line_size)
+  arp_table_type<Config>                        arp_table;
+  arp_resolution_table_type<Config>             arp_resolutions;
+  alignas(Config::cache_line_size)
+  reassembly_table_type<Config>                 reassemblies;
+};
+
+template<typename Config = default_config>
+using interface_ref =
+  reference
+  <
+    interface<Config>
+  >;
+
+template<typename Config = default_config>
 struct port_descriptor
 {
   port_descriptor()
+  : port(0),
+    bound(false)
   {}
   
   port_descriptor
   (
-    interface&  i,
-    uint16_t    p
+    interface<Config>&  i,
+    uint16_t            p
   )
   : intf_ref(i),
-    port(p)
+    port(p),
+    bound(true)
   {}
 
+  explicit
+  port_descriptor
+  (
+    uint16_t    p
+  )
+  : port(p),
+    bound(true)
+  {}
+
+  bool is_bound() const
+  {
+    return bound;
+  }
+
   port_descriptor&
   operator=(const port_descriptor& other)
   {
-    intf_ref  = other.intf_ref;
-    port      = other.port;
+    intf_ref                  = other.intf_ref;
+    port                      = other.port;
+    bound                     = other.bound;
+    rx_buffer_descriptor_refs = other.rx_buffer_descriptor_refs;
+    flow                      = other.flow;
     return *this;
   }
   
-  interface_ref                       intf_ref;
+  /// Empty for a port bound to all interfaces (c_any_interface)
+  interface_ref<Config>               intf_ref;
   uint16_t                            port;
-  ring_buffer<buffer_descriptor_ref>  rx_buffer_descriptor_refs;
+  bool                                bound;
+  ring_buffer
+  <
+    buffer_descriptor_ref<Config>,
+    Config::port_rx_queue_size
+  >                                   rx_buffer_descriptor_refs;
+  udp_flow                            flow;
 };
 
-typedef std::array<interface, c_interface_table_size>                   interface_container;
-typedef haluj::bounded::vector<arp_table_entry, c_arp_table_size>       arp_table_type;
-typedef haluj::bounded::vector<port_descriptor, c_udp_ports_table_size> udp_ports_table_type;
-typedef std::size_t                                                     interface_designator;
-typedef std::optional<std::size_t>                                      endpoint_designator;
-
 } // namespace ipv4
 
 } // namespace protocol
@@ -37,7 +37,6 @@ For more information, please refer to <http://unlicense.org>
 #include <tuple>
 
 #include "protocol/ipv4/stack.hpp"
-#include "protocol/ipv4/bd.hpp"
 
 namespace protocol
 {
@@ -45,647 +44,301 @@ namespace protocol
 namespace ipv4
 {
 
-interface_container           g_interfaces;
-arp_table_type                g_arp_table; 
-udp_ports_table_type          g_udp_ports; 
-std::size_t                   g_ip_identification;
+stack<>                       g_stack;
 
-uint16_t calculate_checksum(uint16_t *ptr, unsigned size)
+bool
+parse_frame
+(
+  const frame&        f,
+  const std::size_t   max_frame_size,
+  packet_metadata&    m
+)
 {
-  unsigned i;
-  unsigned sum = 0;
-
-  for (i = 0; i < (size >> 1); i++, ptr++)
-  {
-    sum += *ptr;
-  }
+  bool result = false;
   
-  if ((size & 0x01) == 0x01)
+  if 
+  (
+    (f.size >= c_min_eth_frame_size) && 
+    (f.size <= max_frame_size)
+  )
   {
-    sum += uint16_t( *reinterpret_cast<const uint8_t*>(ptr) );
-  }
+    m.frame       = f.data;
 
-  while(sum >> 16)
-  {
-    sum = (sum >> 16) + (sum & 0xFFFF); 
-  }
+    const eth_packet_header *eth = m.header<eth_packet_header>(0);
+
+    m.ether_type  = eth->type;
+    m.l3_offset   = sizeof(eth_packet_header);
 
-  return ~sum;
+    switch (m.ether_type.raw())
+    {
+      case c_ether_type_arp.raw():
+        result = (f.size >= m.l3_offset + sizeof(arp_packet));
+        break;
+      case c_ether_type_ipv4.raw():
+        {
+          const ip_packet   *ip           = m.header<ip_packet>(m.l3_offset);
+          const std::size_t total_length = ip->total_length.value();
+          const uint16_t    fragment     = ip->flags_fragment_offset.value();
+
+          // Options are not supported. The minimum frame size already 
+          // covers the IP header
+          if 
+          (
+            (ip->version_length == 0x45) &&
+            (ip->diff_serv == 0) &&
+            ((fragment & c_ip_flag_reserved) == 0) &&
+            (total_length >= sizeof(ip_packet)) &&
+            (m.l3_offset + total_length <= f.size)
+          )
+          {
+            m.ip_protocol     = ip->protocol;
+            m.l4_offset       = m.l3_offset + sizeof(ip_packet);
+            m.payload_offset  = m.l4_offset;
+            m.payload_size    = total_length - sizeof(ip_packet);
+            m.more_fragments  = (fragment & c_ip_flag_more_fragments) != 0;
+            m.fragment_offset = (fragment & c_ip_fragment_offset_mask) * 8;
+            m.is_fragment     = m.more_fragments || (m.fragment_offset != 0);
+            result            = true;
+
+            // The headers of a fragmented datagram are in its first 
+            // fragment, and they are validated once it is reassembled. 
+            // Fragments but the last carry multiples of 8 bytes
+            if (m.is_fragment)
+            {
+              result = 
+                (m.payload_size > 0) &&
+                (!m.more_fragments || (m.payload_size % 8 == 0)) &&
+                (m.fragment_offset + m.payload_size <= 0xFFFF - sizeof(ip_packet));
+            }
+            else
+            {
+              switch (m.ip_protocol)
+              {
+                case UDP:
+                  {
+                    const udp_packet *udp = m.header<udp_packet>(m.l4_offset);
+                  
+                    result = 
+                      (m.payload_size >= sizeof(udp_packet)) &&
+                      (udp->length.value() == m.payload_size);
+                  
+                    if (result)
+                    {
+                      m.payload_offset  += sizeof(udp_packet);
+                      m.payload_size    -= sizeof(udp_packet);
+                    }
+                  }
+                  break;
+                case ICMP:
+                  result = (m.payload_size >= sizeof(icmp_packet));
+                
+                  if (result)
+                  {
+                    m.payload_offset  += sizeof(icmp_packet);
+                    m.payload_size    -= sizeof(icmp_packet);
+                  }
+                  break;
+                default:
+                  break;
+              }
+            }
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  
+  return result;
 }
 
 void 
-write_arp_packet
+initialize()
+{
+  g_stack.initialize();
+}
+
+bool
+set
 (
-  interface&          i,
-  arp_table_entry&    e,
-  const bool          is_response
+  const interface_designator  id,
+  ethernet::address           hw_addr, 
+  ipv4::address               ip_addr,
+  ipv4::address               netmask
 )
 {
-  i.tx_frame_size = sizeof(eth_packet_header) + sizeof(arp_packet);
-  
-  uint8_t           *ptr  = &i.tx_frame_buffer[0];
-  eth_packet_header *eth  = (eth_packet_header*) ptr;
-  arp_packet        *arp  = (arp_packet*) (ptr + sizeof(eth_packet_header));
-
-  eth->dest_hw_addr       = e.hw_addr;
-  eth->source_hw_addr     = i.hw_addr;
-  eth->type               = htons(0x806);
-  
-  arp->htype              = htons(0x0001);
-  arp->ptype              = htons(0x0800);
-  arp->hlen               = 6;
-  arp->plen               = 4;
-  arp->opcode             = (is_response) ? htons(0x0002) : htons(0x0001);
-  
-  arp->sender_hw_addr     = i.hw_addr;
-  arp->sender_ip_addr     = i.ip_addr;
-  arp->target_hw_addr     = e.hw_addr;
-  arp->target_ip_addr     = e.ip_addr;
-  
-  TRACE(__FUNCTION__ << "\n");
-  
-  TRACE(((is_response) ? "Reply\n" : "Request\n"));
-  TRACE("Sender HW Addr : " << i.hw_addr << "\n");
-  TRACE("Sender IP Addr : " << i.ip_addr << "\n");
-  TRACE("Target HW Addr : " << e.hw_addr << "\n");
-  TRACE("Target IP Addr : " << e.ip_addr << "\n");
+  return g_stack.set(id, hw_addr, ip_addr, netmask);
 }
 
-void 
-write_icmp_echo_packet
+bool
+configure
 (
-  interface&        i,
-  const context&    ctxt,
-  ip_packet         *in_ip_ptr,
-  icmp_packet       *in_icmp_ptr
+  const interface_designator  id,
+  const offload_flags_t       offload
 )
 {
-  std::size_t         echo_size = ctxt.last - ctxt.ptr;
-
-  i.tx_frame_size = sizeof(ip_packet) + 
-                    sizeof(eth_packet_header) + 
-                    sizeof(icmp_packet) +
-                    echo_size;
-                    
-  TRACE(__FUNCTION__ << ":" <<  i.tx_frame_size << "\n");
-  
-  unsigned char       *ptr  = (unsigned char*) &i.tx_frame_buffer[0];
-  eth_packet_header   *eth  = (eth_packet_header*) ptr;
-  ip_packet           *ip   = (ip_packet*) (ptr + sizeof(eth_packet_header));
-  icmp_packet         *icmp = (icmp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
-  uint8_t             *echo = (uint8_t*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header) + sizeof(icmp_packet));
-
-  eth->dest_hw_addr         = ctxt.remote_hw_addr;
-  eth->source_hw_addr       = i.hw_addr;
-
-  eth->type                 = htons(0x800);
-  ip->version_length        = 0x45;
-  ip->diff_serv             = 0;
-  ip->total_length          = htons(i.tx_frame_size - sizeof(eth_packet_header));
-  ip->identification        = htons(g_ip_identification++);
-  ip->flags_fragment_offset = 0;
-  ip->protocol              = ICMP;
-  ip->ttl                   = 0x80;
-  ip->src_ip                = i.ip_addr;
-  ip->dest_ip               = in_ip_ptr->src_ip;
-  ip->checksum              = 0;
-  ip->checksum              = calculate_checksum( (uint16_t *) ip, 20);
-  icmp->type                = 0;
-  icmp->code                = 0;
-  icmp->checksum            = 0; // default
-  icmp->identifier          = in_icmp_ptr->identifier;
-  icmp->sequence_number     = in_icmp_ptr->sequence_number;
-
-  std::memcpy(echo, ctxt.ptr, echo_size);
-  
-  icmp->checksum            = calculate_checksum( (uint16_t *) icmp, sizeof(icmp_packet) + echo_size);
-
-  TRACE("IP Checksum :"   <<  std::hex << ip->checksum << std::dec << ", size:20\n");  
-  TRACE("ICMP Checksum :" <<  std::hex << icmp->checksum  << std::dec << ", size:" << sizeof(icmp_packet) + echo_size << "\n");  
+  return g_stack.configure(id, offload);
 }
 
-arp_table_entry_ref
-find_arp_entry
+bool
+set_mtu
 (
-  const address& a
+  const interface_designator  id,
+  const std::size_t           mtu
 )
 {
-  arp_table_entry_ref  result;
-  
-  auto it = std::find_if
-  (
-    std::begin(g_arp_table), 
-    std::end(g_arp_table),
-    [a](auto &b) -> bool
-    {
-      return b.ip_addr == a;
-    }
-  );
-
-  if (it != std::end(g_arp_table))
-  {
-    result = (*it);
-  }
-  
-  return result;
+  return g_stack.set_mtu(id, mtu);
 }
 
-void 
-write_udp_packet
+bool
+set_frame_release
 (
-  interface&          i,
-  arp_table_entry&    e, 
-  buffer_descriptor&  bd  
+  const interface_designator  id,
+  frame_release_function      release
 )
 {
-  std::size_t len = 
-    sizeof(ip_packet) + 
-    sizeof(eth_packet_header) + 
-    sizeof(udp_packet) + 
-    bd.size;
-
-  if (len <= c_max_eth_frame_size)
-  {
-    unsigned char       *ptr      = (unsigned char*) &i.tx_frame_buffer[0];
-    eth_packet_header   *eth      = (eth_packet_header*) ptr;
-    ip_packet           *ip       = (ip_packet*) (ptr + sizeof(eth_packet_header));
-    udp_packet          *udp      = (udp_packet*) (ptr + sizeof(ip_packet) + sizeof(eth_packet_header));
-    unsigned char       *payload  = (ptr +  sizeof(ip_packet) + sizeof(eth_packet_header) + sizeof(udp_packet));
-    
-    i.tx_frame_size = len;
-    
-    eth->dest_hw_addr         = e.hw_addr;
-    eth->source_hw_addr       = i.hw_addr;
-
-    eth->type                 = htons(0x800);
-    ip->version_length        = 0x45;
-    ip->diff_serv             = 0;
-    ip->total_length          = htons(i.tx_frame_size - sizeof(eth_packet_header));
-    ip->identification        = htons(g_ip_identification++);
-    ip->flags_fragment_offset = 0x0040;
-    ip->protocol              = UDP;
-    ip->ttl                   = 0x80;
-    ip->src_ip                = i.ip_addr;
-    ip->dest_ip               = e.ip_addr;
-    ip->checksum              = 0;
-    ip->checksum              = calculate_checksum( (uint16_t *) ip, 20);
-
-    udp->src_port             = htons(bd.port);
-    udp->dest_port            = htons(bd.remote.port);
-    udp->length               = htons(sizeof(udp_packet) + bd.size);
-    udp->checksum             = 0;
-
-    std::memcpy(payload, bd.first, bd.size);
-    
-    checksum    udp_checksum;
-    // psuedo header 
-    udp_checksum.append(&ip->src_ip, sizeof(ip->src_ip));
-    udp_checksum.append(&ip->dest_ip, sizeof(ip->src_ip));
-    udp_checksum.append(htons(uint16_t(ip->protocol)));
-    udp_checksum.append(udp->length);
-    udp_checksum.append(udp, sizeof(udp_packet) + bd.size);
-    udp->checksum             = udp_checksum.finalize();
-
-    TRACE(__FUNCTION__ << " UDP payload size:" << bd.size << "\n");
-  }
-  else
-  {
-    TRACE(__FUNCTION__ << " UDP packet too big:" << bd.size << "\n");
-  }
+  return g_stack.set_frame_release(id, release);
 }
 
-void
-process_arp_packet
+bool
+deliver
 (
-  interface&  i,
-  context&          ctxt
+  const interface_designator  id,
+  const frame_handle&         h
 )
 {
-  // TO-DO size_check
-  arp_packet   *arp;
-  
-  TRACE(__FUNCTION__ << "\n");
+  return g_stack.deliver(id, h);
+}
 
-  arp = (arp_packet*) ctxt.ptr;
+namespace udp
+{
 
-  arp->htype  = ntohs(arp->htype);
-  arp->ptype  = ntohs(arp->ptype);
-  arp->opcode = ntohs(arp->opcode);
-  
-  TRACE("Target IP (" << arp->target_ip_addr << ") == My IP(" << i.ip_addr << ")\n");
-
-  if (// arp->opcode == 1 &&
-      arp->htype  == 1 &&
-      arp->ptype  == 0x800 &&
-      arp->hlen   == 6 &&
-      arp->plen   == 4 &&
-      arp->target_ip_addr == i.ip_addr)
-  {
-    auto e_ref = find_arp_entry( arp->sender_ip_addr );
-    
-    if (e_ref)
-    {
-      // exists in table
-      // update the entry
-      arp_table_entry &e = *e_ref;
-      e.set_complete();
-      e.hw_addr    = arp->sender_hw_addr;
-    }
-    else
-    {
-      // new entry
-      auto r = 
-        haluj::bounded::push_back
-        (
-          g_arp_table,
-          arp_table_entry
-          {
-            arp->sender_hw_addr,
-            arp->sender_ip_addr,
-            true
-          }
-        );
-      if (r)
-      {
-        TRACE("ARP Entry added\n");
-        e_ref = g_arp_table.back();
-      }
-      else
-      {
-        TRACE("ARP Entry add failed\n");
-      }
-    }
-    
-    if ( (arp->opcode == 1) && e_ref)
-    {
-      // is request
-      arp_table_entry &e = *e_ref;
-      // write response 
-      write_arp_packet(i, e, true);
-    }
-  }
+endpoint_designator
+bind
+(
+  const interface_designator id,
+  const uint16_t    port
+)
+{
+  return g_stack.bind(id, port);
 }
 
-void 
-process_icmp_packet
+bool
+unbind
 (
-  interface&  i,
-  context&          ctxt,
-  ip_packet*        ip_ptr
+  const endpoint_designator& ed
 )
 {
-  // TO-DO size_check
-  icmp_packet   *icmp_ptr = (icmp_packet*) (ctxt.ptr);
-  // incoming->icmp = icmp;
-  ctxt.ptr  += sizeof(icmp_packet);
-
-  if (icmp_ptr->type == 0x08)
-  {
-    uint16_t  in_ip_chk   = ip_ptr->checksum;
-    ip_ptr->checksum    = 0;
-    uint16_t  ip_chk      = calculate_checksum( (uint16_t *) ip_ptr, 20);
-
-    uint16_t  in_icmp_chk = icmp_ptr->checksum;
-    icmp_ptr->checksum  = 0;
-    uint16_t  icmp_chk    = calculate_checksum( (uint16_t *) icmp_ptr, std::distance(ctxt.ptr, ctxt.last) + sizeof(icmp_packet));
-//
-    TRACE("IP Checksum   :" << std::hex << in_ip_chk    << " ? " << ip_chk   << "\n");  
-    TRACE("ICMP Checksum :" << std::hex << in_icmp_chk  << " ? " << icmp_chk << "\n");  
-    write_icmp_echo_packet( i, ctxt, ip_ptr, icmp_ptr );
-  }
+  return g_stack.unbind(ed);
 }
 
-void 
-process_udp_packet
+std::size_t 
+received_length
 (
-  interface&  i,
-  context&          ctxt, 
-  ip_packet*        ip_ptr
+  const endpoint_designator& ed
 )
 {
-  udp_packet      *udp_ptr;
-  unsigned        size;
-
-  udp_ptr   = (udp_packet*) ctxt.ptr;
-  ctxt.ptr += sizeof(udp_packet);
-
-  size            = ip_ptr->total_length;
-  size            -= 28;
-
-  udp_ptr->src_port   = ntohs(udp_ptr->src_port);
-  udp_ptr->dest_port  = ntohs(udp_ptr->dest_port);
-  udp_ptr->length     = ntohs(udp_ptr->length);
-  udp_ptr->length     -= 8;
-  
-  auto it = 
-    std::find_if
-    (
-      std::begin(g_udp_ports),
-      std::end(g_udp_ports),
-      [&](auto &p)
-      {
-        return p.port == udp_ptr->dest_port;
-      }
-    );
-
-  TRACE(__FUNCTION__ << "\n");
-  TRACE("UDP SRC PORT:" << udp_ptr->src_port << "\n");
-  TRACE("UDP DST PORT:" << udp_ptr->dest_port << "\n");
-
-  if 
-  ( 
-    ( it != std::end(g_udp_ports) ) && 
-    ( udp_ptr->length == size )
-  )
-  {
-    TRACE("UDP Valid\n");
-
-    if (!it->rx_buffer_descriptor_refs.full())
-    {
-
-      auto bd_ref = 
-        allocate_bd
-        (
-          i.rx_payload_buffer, 
-          i.rx_buffer_descriptors, 
-          size
-        );
-      
-      if (bd_ref)
-      {
-        buffer_descriptor &bd = *bd_ref;
-        
-        std::memcpy(bd.first, ctxt.ptr, size);
-
-        bd.remote = 
-          endpoint
-          {
-            ip_ptr->src_ip,
-            udp_ptr->src_port
-          };
-
-        bd.port         = udp_ptr->dest_port;
-        bd.ip_protocol  = UDP;
-
-        it->rx_buffer_descriptor_refs.push(bd_ref);
-      }
-      else
-      {
-        TRACE(__FUNCTION__ << " : ERROR! Cannot allocate Buffer Descriptor\n");
-      }
-    }
-  }
-  else
-  {
-    TRACE("UDP Invalid\n");
-  }
+  return g_stack.received_length(ed);
 }
 
-inline void 
-process_ip_packet
+std::size_t
+receive
 (
-  interface&  i,
-  context&    ctxt
+  const endpoint_designator&  ed,
+  uint8_t*                    data,
+  const std::size_t           size,
+  endpoint&                   remote
 )
 {
-  ip_packet    *ip;
-
-  /*incoming->ip   =*/ ip = (ip_packet*) ctxt.ptr;
-  ctxt.ptr  += sizeof(ip_packet);
+  return g_stack.receive(ed, data, size, remote);
+}
 
-  if((ip->version_length == 0x45) &&
-     (ip->diff_serv == 0) &&
-     ((ip->flags_fragment_offset == 0) || 
-      (ip->flags_fragment_offset == 0x0040)))
-  {
-    ip->total_length = ntohs(ip->total_length);
-    
-    TRACE("IP Packet Total Length:" << ip->total_length << "\n");
-    TRACE("IP DEST IP:" << ip->dest_ip << "\n");
-    TRACE("IP SRC  IP:" << ip->src_ip << "\n");
-    TRACE("IP PROTO  :" << uint32_t(ip->protocol) << "\n");
-
-    if (ip->dest_ip == g_interfaces[0].ip_addr)
-    {
-      if (ip->protocol == UDP) 
-      {
-        process_udp_packet(i, ctxt, ip);
-      }
-      else if (ip->protocol == ICMP) 
-      {
-        process_icmp_packet(i, ctxt, ip);
-      }
-    }
-  }
-  else
-  {
-    // Not supported IP header
-  }
+rx_lease<>
+receive_view
+(
+  const endpoint_designator&  ed
+)
+{
+  return g_stack.receive_view(ed);
 }
 
 void
-process_received_frame
+release
 (
-  interface&  i, 
-  bool        p_soft_address_match,
-  bool        p_allow_broadcast
+  rx_lease<>&   lease
 )
 {
-  context             ctxt;
-  eth_packet_header   *eth ;
-  static ethernet::address  broadcast_hw_addr{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-
-  TRACE(__FUNCTION__ << "\n");
-
-  TRACE("RX length:" << i.rx_frame_size << "\n");
-
-  ctxt.ptr              = i.rx_frame_buffer.begin();
-  ctxt.last             = i.rx_frame_buffer.begin() + i.rx_frame_size;
-  eth                   = (eth_packet_header*) ctxt.ptr;
-  
-  ctxt.ptr  += sizeof(eth_packet_header);
-
-  TRACE("Dest Addr :" << eth->dest_hw_addr << "\n");
-  TRACE("Src Addr  :" << eth->source_hw_addr << "\n");
-  TRACE("Type      :" << std::hex << eth->type << "(N) -> " << ntohs(eth->type) << std::dec << "(H) \n");
-
-  if 
-  (
-    (i.rx_frame_size >= c_min_eth_frame_size) && 
-    (i.rx_frame_size <= c_max_eth_frame_size)
-  )
-  {    
-    ctxt.remote_hw_addr = eth->source_hw_addr;
-
-    if 
-    ( 
-      (p_allow_broadcast && (broadcast_hw_addr == eth->dest_hw_addr)) ||
-      (p_soft_address_match && (g_interfaces[0].hw_addr == eth->dest_hw_addr)) 
-    )
-    {
-      TRACE("Valid Frame\n");
-      switch(ntohs(eth->type))
-      {
-      case 0x0800:
-        TRACE("IPv4 packet\n");
-        process_ip_packet(i, ctxt);
-        break;  
-      case 0x0806:
-        TRACE("ARP packet\n");
-        process_arp_packet(i, ctxt);
-        break;  
-      default:
-        break;
-      }
-    }
-    else
-    {
-      // Unsupported Frame
-    }
-  }
-  else
-  {
-      TRACE("Ethernet frame size less than 60\n");
-  }
+  g_stack.release(lease);
 }
 
-void 
-initialize()
+tx_lease<>
+acquire_tx
+(
+  const endpoint_designator&  ed,
+  const std::size_t           size
+)
 {
-  for (auto &i : g_interfaces)
-  {
-    invalidate_descriptors(i.tx_buffer_descriptors);
-    invalidate_descriptors(i.rx_buffer_descriptors);
-    reset_descriptor_ranges(i.tx_payload_buffer, i.tx_buffer_descriptors);  
-    reset_descriptor_ranges(i.rx_payload_buffer, i.rx_buffer_descriptors);  
-  }
+  return g_stack.acquire_tx(ed, size);
 }
 
-bool
-set
+std::size_t
+commit_tx
 (
-  const interface_designator  id,
-  ethernet::address           hw_addr, 
-  ipv4::address               ip_addr
+  tx_lease<>&                 lease,
+  const endpoint&             remote
 )
 {
-  bool result = false;
-
-  if (id < c_interface_table_size)
-  {
-    auto &n = g_interfaces[id];
-    n.hw_addr = hw_addr;
-    n.ip_addr = ip_addr;
-    result = true;
-  }
- 
-  return result;
+  return g_stack.commit_tx(lease, remote);
 }
 
-namespace udp
+void
+release
+(
+  tx_lease<>&   lease
+)
 {
+  g_stack.release(lease);
+}
 
-endpoint_designator
-bind
+std::size_t
+send
 (
-  const interface_designator id,
-  const uint16_t    port
+  const endpoint_designator&  ed,
+  const uint8_t               *data,
+  const std::size_t           size,
+  const endpoint&             remote
 )
 {
-  endpoint_designator  result;
-
-  TRACE("Binding " << port << " to " << id << "\n");
-  
-  if ( id < c_interface_table_size )
-  {
-
-    auto e = 
-      haluj::bounded::push_back
-        (
-          g_udp_ports, 
-          port_descriptor(g_interfaces[id], port)
-        );
-    
-    if (e)
-    {
-      result = g_udp_ports.size() - 1;
-    }
-  }
-  // Return the interface index
-  return result;
+  return g_stack.send(ed, data, size, remote);
 }
 
-std::size_t 
-received_length
+std::size_t
+commit_tx
 (
-  const endpoint_designator& ed
+  tx_lease<>&                 lease
 )
 {
-  std::size_t result = 0;
-  
-  if (ed && *ed < g_udp_ports.size() )
-  {
-    auto &p       = g_udp_ports[*ed];
-    interface &i  = *p.intf_ref;
-      
-    TRACE( __FUNCTION__ << " p.rx_buffer_descriptor_refs.size() " << p.rx_buffer_descriptor_refs.size() << " \n" );
-    
-    if (!p.rx_buffer_descriptor_refs.empty())
-    {
-      buffer_descriptor &bd = *p.rx_buffer_descriptor_refs.front();
-      result = bd.size;
-    }
-  }
-  
-  return result;
+  return g_stack.commit_tx(lease);
 }
 
-std::size_t
-receive
+bool
+connect
 (
   const endpoint_designator&  ed,
-  uint8_t*                    data,
-  const std::size_t           size,
-  endpoint&                   remote
+  const endpoint&             remote
 )
 {
-  std::size_t  result = 0;
-  
-  if (ed && *ed < g_udp_ports.size() )
-  {
-    auto &p       = g_udp_ports[*ed];
-    interface &i  = *p.intf_ref;
-    
-    if ( !p.rx_buffer_descriptor_refs.empty() )
-    {
-      buffer_descriptor &bd = *p.rx_buffer_descriptor_refs.front();
-      p.rx_buffer_descriptor_refs.pop();
-      
-      auto &f = bd.flags;
-      
-      if (f.test<valid>())
-      {
-        f.clear<valid>();
-        
-        auto read_size = std::min(size, bd.size);
-
-        std::memcpy(data, bd.first, read_size);
-        
-        remote = bd.remote;
-        result = read_size;
-      }
-    }
-    else
-    {
-      TRACE("Nothing to receive\n");
-    }
-  }
-  else
-  {
-    TRACE("Endpoint invalid");
-  }
-  
-  return result;
+  return g_stack.connect(ed, remote);
+}
+
+void
+disconnect
+(
+  const endpoint_designator&  ed
+)
+{
+  g_stack.disconnect(ed);
 }
 
 std::size_t
@@ -693,46 +346,10 @@ send
 (
   const endpoint_designator&  ed,
   const uint8_t               *data,
-  const std::size_t           size,
-  const endpoint&             remote
+  const std::size_t           size
 )
 {
-  std::size_t result = 0U;
-  
-  if (ed && *ed < g_udp_ports.size() )
-  {
-    auto      &p = g_udp_ports[*ed];
-    interface &i = *p.intf_ref;
-
-    auto bd_ref = 
-      allocate_bd
-      (
-        i.tx_payload_buffer, 
-        i.tx_buffer_descriptors, 
-        size
-      );
-    
-    if (bd_ref)
-    {
-      buffer_descriptor &bd = *bd_ref;
-      
-      std::memcpy(bd.first, data, size);
-      
-      TRACE(__FUNCTION__ << "-> tx payload:" << std::string(bd.first, bd.last) << "\n" );
-      
-      bd.port         = p.port;
-      bd.remote       = remote;
-      bd.ip_protocol  = UDP;
-      
-      result = size;     
-    }
-    else
-    {
-      TRACE("ERROR! Cannot allocate transmit buffer descriptor\n");
-    }
-  }
-  
-  return result;
+  return g_stack.send(ed, data, size);
 }
 
 } // namespace udp
@@ -740,4 +357,3 @@ send
 } // namespace ipv4
 
 } // namespace protocol
-